@@ -0,0 +1,73 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Axis-aligned bounding box.
+struct Aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Closest intersection found along a ray.
+struct RayHit {
+    float distance;
+    int primitive;
+    glm::vec3 normal;
+};
+
+// Number of rays traced together by Bvh::intersectPacket.
+const int RAY_PACKET_SIZE = 8;
+
+// Coherent rays in structure-of-arrays layout, so four lanes at a time load
+// straight into a SIMD register.
+struct RayPacket {
+    float originX[RAY_PACKET_SIZE];
+    float originY[RAY_PACKET_SIZE];
+    float originZ[RAY_PACKET_SIZE];
+    float dirX[RAY_PACKET_SIZE];
+    float dirY[RAY_PACKET_SIZE];
+    float dirZ[RAY_PACKET_SIZE];
+    // In: maximum distance. Out: distance to the closest hit, if any.
+    float tMax[RAY_PACKET_SIZE];
+    // Out: index of the primitive hit, or -1.
+    int primitive[RAY_PACKET_SIZE];
+};
+
+// Bounding volume hierarchy over axis-aligned boxes.
+class Bvh {
+public:
+    Bvh();
+
+    // Rebuild the hierarchy over the given boxes. Primitive indices in hits
+    // refer to positions in this vector.
+    void build(const std::vector<Aabb> &primitives);
+
+    // Closest hit along origin + t * dir for t in [0, tMax], dir normalised.
+    // Every box is grown by `inflate`, which turns the ray into a swept sphere.
+    // Boxes that already contain the origin are ignored.
+    bool intersect(const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float inflate, RayHit &hit) const;
+
+    // Closest hit for every ray of the packet. The packet descends into a
+    // node as soon as any of its rays overlaps it.
+    void intersectPacket(RayPacket &packet) const;
+
+    bool isEmpty() const;
+
+private:
+    struct Node {
+        glm::vec3 min;
+        int leftOrFirst; // First child for inner nodes, first primitive index for leaves.
+        glm::vec3 max;
+        int count;       // Number of primitives; 0 for inner nodes.
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Aabb> primitives;
+    std::vector<int> indices;
+
+    void subdivide(int nodeIndex, int first, int count);
+};
+
+#endif // BVH_H
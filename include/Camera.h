@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+class Drone;
+
 enum CameraType {
     GLOBAL,
     CHOPPER,
@@ -23,11 +25,20 @@ public:
     void setPosition(const glm::vec3 &position);
     void setTarget(const glm::vec3 &target);
     void setUp(const glm::vec3 &up);
+    void setAspectRatio(float aspect);
+    // Distance to the far clipping plane.
+    void setFarClip(float distance);
+
+    glm::vec3 getPosition() const;
 
     CameraType getType() const;
 
+    // Place the camera in the cockpit of a drone, looking where the drone is heading.
+    void followCockpit(const Drone &drone);
+
     // For chopper camera rotation control.
     void setAngle(float angle);
+    float getAngle() const;
 
 private:
     CameraType type;
@@ -6,13 +6,14 @@
 
 class Drone {
 public:
-    Drone();
+    // The drone starts at, and resets to, its home position.
+    Drone(const glm::vec3 &home = glm::vec3(0.0f, 2.0f, 0.0f));
 
     // Update drone animation and state.
     void update(float deltaTime);
 
     // Render the drone model using the provided shader.
-    void render(Shader* shader);
+    void render(Shader* shader) const;
 
     // Control methods.
     void increasePropellerSpeed();
@@ -26,19 +27,49 @@ public:
     void turnDown();
     void reset();
 
+    // Control parameters: propeller speed (which also sets the movement step)
+    // and the angle turned per turn command, in degrees.
+    void setPropellerSpeed(float speed);
+    float getPropellerSpeed() const;
+    void setTurnRate(float degrees);
+    float getTurnRate() const;
+
     // Get current position
     glm::vec3 getPosition() const;
+    // Place the drone, e.g. after collision response.
+    void setPosition(const glm::vec3 &pos);
     // Compute the front direction of the drone.
     glm::vec3 getFront() const;
     // Get current rotation
     glm::vec3 getRotation() const;
+    // Orient the drone, e.g. along a scripted flight path.
+    void setRotation(const glm::vec3 &rot);
+    glm::vec3 getHome() const;
+    // True while the roll animation is playing.
+    bool isPerformingRoll() const;
+
+    // External force (e.g. wind drag) acting on the drone during the next update.
+    void applyForce(const glm::vec3 &force);
+    // Drift velocity caused by external forces.
+    glm::vec3 getVelocity() const;
+    void setVelocity(const glm::vec3 &vel);
+
+    // Everything the simulation depends on, as STATE_FLOATS plain floats, for snapshots.
+    // The propeller angle only animates the model and is left out.
+    static constexpr int STATE_FLOATS = 19;
+    void saveState(float* state) const;
+    void restoreState(const float* state);
 
 private:
+    glm::vec3 home;
     glm::vec3 position;
     glm::vec3 rotation; // rotation.x = pitch, rotation.y = yaw, rotation.z = roll
+    glm::vec3 velocity;
+    glm::vec3 force; // Accumulated until the next update.
 
     // Propeller speed and state.
     float propellerSpeed;
+    float turnRate;
 
     // Roll animation state.
     bool isRolling;
@@ -47,13 +78,13 @@ private:
     float currentPropellerAngle;
 
     // Helper functions for rendering parts.
-    void renderBody(Shader* shader);
-    void renderPropeller(Shader* shader, const glm::vec3 &offset);
-    void renderLandingGear(Shader* shader);
+    void renderBody(Shader* shader) const;
+    void renderPropeller(Shader* shader, const glm::vec3 &offset) const;
+    void renderLandingGear(Shader* shader) const;
 
     // Utility functions to draw primitives.
-    void drawCube(Shader* shader, const glm::mat4 &model, const glm::vec3 &color);
-    void drawQuad(Shader* shader, const glm::mat4 &model, const glm::vec3 &color);
+    void drawCube(Shader* shader, const glm::mat4 &model, const glm::vec3 &color) const;
+    void drawQuad(Shader* shader, const glm::mat4 &model, const glm::vec3 &color) const;
 };
 
 #endif // DRONE_H
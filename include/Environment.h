@@ -0,0 +1,46 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "Bvh.h"
+#include "Shader.h"
+
+// Static obstacles the drones share the room with: the floor, the four
+// walls and any number of box obstacles, all indexed by one BVH.
+class Environment {
+public:
+    // Inner faces of the default room's walls, and their height.
+    static constexpr float ROOM_HALF_WIDTH = 20.0f;
+    static constexpr float ROOM_HEIGHT = 10.0f;
+
+    // Builds the default room: a 40x40 floor, walls at +/-20 and a few obstacles.
+    Environment();
+
+    // Add a box obstacle. Call build() once all obstacles have been added.
+    void addBox(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &color);
+    // Remove every obstacle, including the floor and the walls.
+    void clear();
+    void build();
+
+    // Move a sphere from `from` towards `to`, stopping at obstacles and
+    // sliding along the surfaces it touches. Returns the resolved position
+    // and sets `collided` when any obstacle was touched.
+    glm::vec3 sweepSphere(const glm::vec3 &from, const glm::vec3 &to, float radius, bool &collided) const;
+
+    // Whether a sphere touches any obstacle.
+    bool overlapsSphere(const glm::vec3 &centre, float radius) const;
+
+    // Render every obstacle.
+    void render(Shader* shader) const;
+
+    const Bvh &getBvh() const;
+    const std::vector<Aabb> &getBoxes() const;
+
+private:
+    std::vector<Aabb> boxes;
+    std::vector<glm::vec3> colors;
+    Bvh bvh;
+};
+
+#endif // ENVIRONMENT_H
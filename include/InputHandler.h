@@ -3,17 +3,23 @@
 
 #include <GLFW/glfw3.h>
 #include "Scene.h"
+#include "SceneRenderer.h"
 
 class InputHandler {
 public:
     // GLFW key callback.
     static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
-    // Set the scene pointer for input interactions.
+    // Set the scene pointer for input interactions. Simulation input is
+    // posted to the scene and runs on the simulation thread.
     static void setScene(Scene* scenePtr);
 
+    // Set the renderer pointer for camera and sensor view switching.
+    static void setRenderer(SceneRenderer* rendererPtr);
+
 private:
     static Scene* scene;
+    static SceneRenderer* renderer;
 };
 
 #endif // INPUTHANDLER_H
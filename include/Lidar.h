@@ -0,0 +1,46 @@
+#ifndef LIDAR_H
+#define LIDAR_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "Bvh.h"
+#include "Drone.h"
+#include "ThreadPool.h"
+
+// Simulated multi-beam lidar mounted on every drone.
+//
+// Each drone casts channels x beamsPerChannel rays: channels are spread
+// evenly over the vertical field of view and beams sweep a full circle
+// around the drone. Rays are traced as coherent packets through the BVH
+// and packets are distributed over a thread pool.
+class Lidar {
+public:
+    Lidar(int channels = 16, int beamsPerChannel = 32, float verticalFov = 30.0f, float maxRange = 40.0f);
+
+    // Scan the world from every drone.
+    void scan(const Bvh &world, const std::vector<Drone> &drones, ThreadPool &pool);
+
+    // Hit distance per ray, indexed [drone * getRaysPerDrone() + ray].
+    // Rays that hit nothing report the maximum range.
+    const std::vector<float> &getRanges() const;
+    int getRaysPerDrone() const;
+
+    // Throughput of the ray caster since the last resetStats().
+    double getRaysPerSecond() const;
+    void resetStats();
+
+private:
+    int raysPerDrone;
+    int packetsPerDrone;
+    float maxRange;
+
+    // Ray directions in the drone's local frame, structure-of-arrays.
+    std::vector<float> localX, localY, localZ;
+
+    std::vector<float> ranges;
+
+    long long raysCast;
+    double secondsSpent;
+};
+
+#endif // LIDAR_H
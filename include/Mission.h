@@ -0,0 +1,182 @@
+#ifndef MISSION_H
+#define MISSION_H
+
+#include <glm/glm.hpp>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Drone;
+class Scene;
+class MissionScheduler;
+
+// Fixed-size block allocator for coroutine frames. Frames are rounded up to
+// a size class and recycled through per-class free lists, so starting and
+// finishing thousands of missions never touches the general heap after
+// warm-up. Each thread has its own pool.
+class MissionFramePool {
+public:
+    static void* allocate(std::size_t size);
+    static void release(void* frame, std::size_t size);
+};
+
+// A scripted flight for one drone, written as a C++20 coroutine:
+//
+//     Mission patrol() {
+//         co_await takeOff(4.0f);
+//         co_await waitFor(1.5f);
+//         co_await flyTo(glm::vec3(5.0f, 4.0f, 5.0f), 3.0f);
+//         co_await land();
+//     }
+//
+// The coroutine starts suspended; MissionScheduler::start() takes it over
+// and resumes it only when what it awaits is done.
+class Mission {
+public:
+    struct promise_type {
+        MissionScheduler* scheduler = nullptr;
+        int drone = -1;
+
+        Mission get_return_object() {
+            return Mission(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        // The scheduler destroys finished frames.
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+
+        static void* operator new(std::size_t size) { return MissionFramePool::allocate(size); }
+        static void operator delete(void* frame, std::size_t size) { MissionFramePool::release(frame, size); }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Mission(Mission &&other) noexcept;
+    Mission &operator=(Mission &&other) noexcept;
+    ~Mission();
+
+    Mission(const Mission&) = delete;
+    Mission &operator=(const Mission&) = delete;
+
+private:
+    Handle handle;
+
+    explicit Mission(Handle handle);
+    friend class MissionScheduler;
+};
+
+// Motion carried out on a mission's behalf while it is suspended. The
+// scheduler steps every active controller once per tick and resumes the
+// mission when its controller finishes.
+struct MotionController {
+    enum Kind { FLY_TO, CLIMB, ORBIT, ROLL, ROUTE };
+    Kind kind;
+    glm::vec3 target;  // FLY_TO, ROUTE: destination. CLIMB: target height in y. ORBIT: centre.
+    float speed;       // Units per second along the path.
+    // ORBIT only; the radius and start angle are taken from the drone when the motion starts.
+    float radius;
+    float angle;       // Current angle around the centre, radians.
+    float angleLeft;   // Angle still to cover, radians.
+    // Seconds before the motion gives up, e.g. when an obstacle blocks the way.
+    float timeLeft;
+};
+
+// Runs the missions of a Scene on the simulation thread.
+//
+// Sleeping missions sit in a hashed timer wheel with one slot per tick, so
+// each tick only looks at the missions in the current slot; a mission due
+// more than one revolution ahead stays in its slot and is skipped until its
+// revolution comes round. Missions waiting on a motion cost one controller
+// step per tick, and nothing is resumed until it completes.
+class MissionScheduler {
+public:
+    explicit MissionScheduler(Scene &scene);
+    ~MissionScheduler();
+
+    MissionScheduler(const MissionScheduler&) = delete;
+    MissionScheduler& operator=(const MissionScheduler&) = delete;
+
+    // Take over a mission and run it on the given drone from the next update.
+    void start(Mission mission, int drone);
+
+    // Advance one tick: step the motion controllers and resume every mission that is due.
+    void update(float deltaTime);
+
+    bool hasMission(int drone) const;
+    int getActiveCount() const;
+    // Missions resumed since the last resetStats().
+    long long getResumeCount() const;
+    void resetStats();
+
+    // Used by the awaitables below.
+    void sleep(Mission::Handle handle, float seconds);
+    void control(Mission::Handle handle, const MotionController &controller);
+    Drone &getDrone(int drone);
+
+private:
+    static constexpr int WHEEL_SLOTS = 256;
+
+    struct Timer {
+        Mission::Handle handle;
+        long long dueTick;
+    };
+    struct ActiveControl {
+        Mission::Handle handle;
+        MotionController controller;
+    };
+
+    Scene &scene;
+    // Ticks run by this scheduler. It only moves forward, even when the scene is rewound.
+    long long currentTick;
+
+    std::vector<Timer> wheel[WHEEL_SLOTS];
+    std::vector<ActiveControl> controls;
+    std::vector<Mission::Handle> ready;
+    std::vector<Mission::Handle> resuming;
+
+    std::vector<char> busyDrones;
+    int activeCount;
+    long long resumeCount;
+
+    void resume(Mission::Handle handle);
+    bool stepController(MotionController &controller, int drone, float deltaTime);
+};
+
+// Awaitables for use inside missions.
+struct MissionSleep {
+    float seconds;
+    bool await_ready() const { return seconds <= 0.0f; }
+    void await_suspend(Mission::Handle handle) { handle.promise().scheduler->sleep(handle, seconds); }
+    void await_resume() {}
+};
+
+struct MissionMotion {
+    MotionController controller;
+    bool await_ready() const { return false; }
+    void await_suspend(Mission::Handle handle) { handle.promise().scheduler->control(handle, controller); }
+    void await_resume() {}
+};
+
+// Wait for a number of simulated seconds.
+MissionSleep waitFor(float seconds);
+// Climb straight up to the given height.
+MissionMotion takeOff(float height, float speed = 2.0f);
+// Fly in a straight line, facing the direction of travel.
+MissionMotion flyTo(const glm::vec3 &target, float speed = 3.0f);
+// Circle around the vertical axis through `center`, at the drone's current height and distance.
+MissionMotion orbit(const glm::vec3 &center, float turns, float speed = 3.0f);
+// Perform the drone's 360 degree roll and wait for it to finish.
+MissionMotion rollManeuver();
+// Descend straight down onto the floor.
+MissionMotion land(float speed = 1.5f);
+// Fly a planned route around the obstacles and other drones, replanned as they move.
+// Gives up if no route can be found.
+MissionMotion flyRoute(const glm::vec3 &target, float speed = 3.0f);
+
+// Demo mission: take off, fly a square around home, orbit, roll, come back and land.
+Mission patrolMission(glm::vec3 home, float delay);
+// Demo mission: fly planned routes to a few random points in the room, then return home and land.
+Mission courierMission(glm::vec3 home, uint32_t seed);
+
+#endif // MISSION_H
@@ -0,0 +1,185 @@
+#ifndef PATHPLANNER_H
+#define PATHPLANNER_H
+
+#include <glm/glm.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Drone.h"
+#include "Environment.h"
+#include "ThreadPool.h"
+#include "VoxelGrid.h"
+
+// D* Lite search for one drone over a voxel grid, 26-connected.
+//
+// The search runs backwards from the goal, so when the drone moves or the
+// occupancy changes only the cells whose costs are affected are
+// re-expanded instead of searching again from scratch. The drone's own cell
+// and the goal cell always count as free. A new goal starts a fresh search.
+class DStarLite {
+public:
+    DStarLite();
+
+    // Plan from `start` to `goal` on `grid`, reusing the previous search if
+    // the goal is unchanged. Fills `path` with the cells from start to goal
+    // and returns false if the goal cannot be reached.
+    bool plan(const std::shared_ptr<const VoxelGrid> &grid, int start, int goal, std::vector<int> &path);
+
+    // Cells expanded by the last plan().
+    long long getExpansions() const;
+
+private:
+    static constexpr int NEIGHBOURS = 26;
+
+    struct QueueEntry {
+        float key1;
+        float key2;
+        int cell;
+        uint32_t stamp;
+        bool operator<(const QueueEntry &other) const; // Orders a max-heap as a min-heap.
+    };
+
+    // A move to one of the 26 neighbours, resolved for the current grid.
+    struct Neighbour {
+        int dx, dy, dz;
+        int offset; // Difference in cell index.
+        float length;
+        // Index offsets of the straight moves a diagonal move is made of.
+        int sides[3];
+        int sideCount;
+    };
+
+    std::shared_ptr<const VoxelGrid> grid;
+    // Cached from the grid so the inner loops need no calls into it.
+    const uint8_t* cells;
+    int sizeX, sizeY, sizeZ;
+    Neighbour neighbours[NEIGHBOURS];
+
+    int start;
+    int goal;
+    int lastStart;
+    float keyModifier; // k_m: heuristic drift from start moves since the search began.
+
+    std::vector<float> g;
+    std::vector<float> rhs;
+    // Lazy-deletion heap: an entry is live while its stamp matches the cell's.
+    std::vector<QueueEntry> queue;
+    std::vector<uint32_t> stamps;
+    std::vector<uint8_t> queued;
+
+    long long expansions;
+    std::vector<int> changed;
+
+    void setGrid(const std::shared_ptr<const VoxelGrid> &newGrid);
+    void reset(int cellCount);
+    bool isBlocked(int cell) const;
+    // Whether a move from a free cell to a neighbour is allowed: the
+    // neighbour must be free, and a diagonal move may not cut past a blocked cell.
+    bool canMove(int from, const Neighbour &neighbour) const;
+    template <typename Fn>
+    void forEachNeighbour(int cell, Fn fn) const;
+    float heuristic(int a, int b) const;
+    void calculateKey(int cell, float &key1, float &key2) const;
+    void push(int cell);
+    void updateVertex(int cell);
+    void updateAround(int cell);
+    bool computeShortestPath();
+};
+
+// A route found for a drone, as waypoints from its position to its goal.
+struct RoutePlan {
+    int drone;
+    bool found;
+    bool replan; // Reused an earlier search of the same goal.
+    std::vector<glm::vec3> waypoints;
+    long long expansions;
+    double seconds;
+};
+
+// Keeps a route to a goal for any number of drones.
+//
+// Every GRID_INTERVAL_TICKS the simulation thread publishes a new voxel grid
+// of the obstacles and the drones. Each drone with a route whose plan is
+// older than the newest grid, or whose goal changed, then gets a planning
+// job on the planner's own thread pool, which updates that drone's D* Lite
+// search against the new grid. A backlog of plans thus never delays the
+// simulation's parallel loops. Finished plans are collected on the
+// simulation thread.
+class RoutePlanner {
+public:
+    static constexpr int GRID_INTERVAL_TICKS = 30;
+
+    RoutePlanner(const Environment &environment, float droneRadius);
+    // Waits for every job in flight.
+    ~RoutePlanner();
+
+    RoutePlanner(const RoutePlanner&) = delete;
+    RoutePlanner& operator=(const RoutePlanner&) = delete;
+
+    // Keep a route from the drone to the goal until cancelled.
+    void request(int drone, const glm::vec3 &goal);
+    void cancel(int drone);
+    void cancelAll();
+    bool hasRoute(int drone) const;
+    // The last plan for the drone's current goal found no way there.
+    bool hasFailed(int drone) const;
+    int getActiveCount() const;
+
+    // Simulation thread, once per tick: publish a new grid when it is due and start the plans that are out of date.
+    void update(const std::vector<Drone> &drones, long long tick);
+    // Plans finished since the last call, for drones whose route is still wanted.
+    void collectResults(std::vector<RoutePlan> &results);
+
+    std::shared_ptr<const VoxelGrid> getGrid() const;
+
+    // Since the last resetStats(): plans finished per second of wall time,
+    // and the average cost of fresh plans and of incremental replans.
+    double getPlansPerSecond() const;
+    long long getPlanCount() const;
+    long long getReplanCount() const;
+    double getAveragePlanMicros() const;
+    double getAverageReplanMicros() const;
+    double getAveragePlanExpansions() const;
+    double getAverageReplanExpansions() const;
+    void resetStats();
+    std::size_t getMemoryUsage() const;
+
+private:
+    struct Route {
+        bool active = false;
+        bool busy = false; // A job is planning it; only that job may touch the search.
+        bool goalChanged = false;
+        bool failed = false;
+        glm::vec3 goal = glm::vec3(0.0f);
+        long long plannedVersion = 0; // Grid version of the last plan started.
+        std::unique_ptr<DStarLite> search;
+    };
+
+    VoxelGrid obstacles;
+    std::shared_ptr<const VoxelGrid> grid;
+    long long gridTick;
+    std::vector<glm::vec3> dronePositions;
+    std::vector<Route> routes;
+    int activeCount;
+
+    // Shared with the jobs.
+    mutable std::mutex mutex;
+    std::condition_variable jobsDone;
+    std::vector<RoutePlan> finished;
+    int jobsInFlight;
+
+    std::chrono::steady_clock::time_point statsStart;
+    long long planCount, replanCount;
+    double planSeconds, replanSeconds;
+    long long planExpansions, replanExpansions;
+
+    // Declared last so its threads finish before the state above goes away.
+    ThreadPool planners;
+
+    void startPlan(int drone, const glm::vec3 &position);
+};
+
+#endif // PATHPLANNER_H
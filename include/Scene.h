@@ -3,35 +3,222 @@
 
 #include "Drone.h"
 #include "Camera.h"
-#include "Shader.h"
+#include "Environment.h"
+#include "Lidar.h"
+#include "Mission.h"
+#include "PathPlanner.h"
+#include "ThreadPool.h"
+#include "RewindBuffer.h"
+#include "TelemetryStore.h"
+#include "Terrain.h"
+#include "Trajectory.h"
+#include "WindField.h"
+#include "TripleBuffer.h"
+#include "WorldState.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+// The simulation side of the world. Scene owns the fleet, the obstacles and
+// the camera rigs, advances them one fixed tick at a time and publishes an
+// immutable WorldState after every tick for the render thread (see
+// SceneRenderer). Other threads never touch the simulation directly: they
+// post commands which run on the simulation thread at the start of a tick.
 class Scene {
 public:
-    Scene(int width, int height);
+    // Fixed simulation step.
+    static constexpr float TICK_SECONDS = 0.016f;
 
+    // The fleet is laid out on a grid around the origin; drone 0 is the one piloted by the user.
+    // A world may also start empty and have drones added later.
+    // The seed drives everything random in the world, e.g. the wind.
+    Scene(int droneCount = 1, uint32_t seed = 1);
+    ~Scene();
+
+    // Advance the simulation by one tick, after running any posted commands.
     void update();
-    void render(Shader* shader);
 
-    // Returns a pointer to the drone
+    // Run update() and publish() on a dedicated thread at the tick rate.
+    void start();
+    void stop();
+
+    // Queue a command to run on the simulation thread. Safe to call from any thread.
+    void post(std::function<void(Scene&)> command);
+
+    // Producer side: copy the current state into the triple buffer.
+    void publish();
+    // Consumer side: the newest published state. Never blocks.
+    const WorldState &acquireLatestState(bool* updated = nullptr);
+
+    // Ticks simulated so far; safe to read from any thread.
+    long long getSimulatedTicks() const;
+
+    // Returns a pointer to the piloted drone
     Drone* getDrone();
+    // Returns a pointer to any drone of the fleet
+    Drone* getDrone(int index);
+    int getDroneCount() const;
+
+    // Send a drone back to its home position without sweeping it through obstacles.
+    void resetDrone(int index);
+    // Grow or shrink the fleet, e.g. as drones migrate between shards. Removing
+    // a drone moves the last one into its index. Drones on a mission or a route must not be removed.
+    int addDrone(const Drone &drone);
+    void removeDrone(int index);
+
+    // Move a drone to a new pose, also without sweeping it.
+    void placeDrone(int index, const glm::vec3 &position, const glm::vec3 &rotation);
+
+    // Number of drone moves stopped or deflected by an obstacle so far.
+    long long getCollisionCount() const;
+
+    const Environment &getEnvironment() const;
+
+    // Replace the room with a heightmap terrain read from a file, generating
+    // the file first if it does not exist. The floor, walls and obstacles go,
+    // drones collide with the ground instead, and the global and chopper
+    // cameras follow drone 0. Call before start(). Returns false if the map
+    // cannot be opened or generated.
+    bool enableTerrain(const std::string &path);
+    // The terrain, or nullptr in the room.
+    const TerrainMap* getTerrain() const;
+
+    // Scripted missions, resumed on the simulation thread every tick.
+    MissionScheduler &getMissions();
+    // Send every drone without a mission on the demo patrol.
+    void startDemoMissions();
+
+    // Smooth paths followed by drones. A drone on a path is moved along it
+    // every tick and faces the direction of travel.
+    TrajectoryEngine &getTrajectories();
+    // Send every drone without a mission round its own loop through a few
+    // waypoints near home, or take every drone off its path.
+    void startDemoTrajectories();
+    void stopTrajectories();
+    bool hasTrajectories() const;
+
+    // Collision-free routes through the room, planned on the worker threads
+    // and flown as trajectories. A drone keeps its route, replanned as the
+    // other drones move, until it is cancelled.
+    void requestRoute(int drone, const glm::vec3 &goal, float speed);
+    void cancelRoute(int drone);
+    bool isRouteFailed(int drone) const;
+    RoutePlanner &getRoutes();
+    // Send every drone without a mission on the demo courier mission.
+    void startDemoRoutes();
+
+    // While enabled, every drone is pushed around by the wind field.
+    void setWindEnabled(bool enabled);
+    bool isWindEnabled() const;
+    WindField &getWindField();
+
+    // The lidar scans from every drone each tick while enabled.
+    void setLidarEnabled(bool enabled);
+    const Lidar &getLidar() const;
 
-    // Set active camera by index: 0 - Global, 1 - Chopper, 2 - First-person.
-    void setActiveCamera(int index);
+    // Append every drone's pose to a telemetry store each tick. Returns false if the file cannot be created.
+    bool startRecording(const std::string &path);
+    void stopRecording();
 
-    // Get the active camera.
-    Camera* getActiveCamera();
+    // Flat binary snapshot of the simulation: the fleet, the camera angles and the sim clock.
+    void saveSnapshot(std::vector<unsigned char> &blob) const;
+    // Returns false if the blob does not match this world's layout.
+    bool restoreSnapshot(const std::vector<unsigned char> &blob);
+
+    // Simulation clock.
+    long long getTick() const;
+    float getSimTime() const;
+
+    // Headless batch runs can switch off the rewind history to save memory,
+    // and the periodic statistics printed to the console.
+    void setHistoryEnabled(bool enabled);
+    void setStatsEnabled(bool enabled);
+
+    // While paused the clock stops and the world can be stepped through its recorded history.
+    void setPaused(bool paused);
+    bool isPaused() const;
+    void stepBack();
+    void stepForward();
+    // Jump back in the recorded history.
+    void rewind(float seconds);
 
 private:
-    Drone drone;
+    std::vector<Drone> drones;
+    // Camera rigs driven by the simulation: 0 - Global, 1 - Chopper, 2 - First-person.
     std::vector<Camera*> cameras;
-    int activeCameraIndex;
 
-    int screenWidth;
-    int screenHeight;
+    MissionScheduler missions;
+    TrajectoryEngine trajectories;
+    double trajectorySeconds;
+
+    // Obstacles, and where each drone was at the end of the previous tick so its motion can be swept.
+    Environment environment;
+    std::unique_ptr<TerrainMap> terrain;
+    std::vector<glm::vec3> previousPositions;
+    std::vector<unsigned> teleports;
+    long long collisionCount;
+
+    // Wind over the room, and the fleet's positions and sampled wind in structure-of-arrays layout.
+    WindField wind;
+    bool windEnabled;
+    std::vector<float> windPositionsX, windPositionsY, windPositionsZ;
+    std::vector<float> windX, windY, windZ;
+    double windSeconds;
+
+    ThreadPool workers;
+
+    // Route planning, and the trajectory path and speed of every routed drone.
+    RoutePlanner routes;
+    std::vector<int> routePaths;
+    std::vector<float> routeSpeeds;
+    std::vector<RoutePlan> routeResults;
+    Lidar lidar;
+    bool lidarEnabled;
+
+    // Number of ticks simulated so far.
+    long long tick;
+    std::atomic<long long> simulatedTicks;
+
+    TelemetryWriter telemetry;
+
+    // Rolling history of snapshots for rewinding.
+    RewindBuffer history;
+    bool historyEnabled;
+    bool statsEnabled;
+    std::vector<unsigned char> snapshotScratch;
+    bool paused;
+
+    // Hand-off to the render thread.
+    TripleBuffer<WorldState> states;
+
+    // Commands posted from other threads, swapped out at the start of each tick.
+    std::mutex commandMutex;
+    std::vector<std::function<void(Scene&)>> pendingCommands;
+    std::vector<std::function<void(Scene&)>> runningCommands;
+
+    std::thread simulationThread;
+    std::atomic<bool> running;
+
+    void runSimulation();
+    void executeCommands();
+    // One home per drone, clear of the obstacles and inside the walls; fleets
+    // too large for the room even when packed tightly rise above the walls.
+    std::vector<glm::vec3> layoutFleet(int droneCount) const;
 
-    void renderMarkers(Shader* shader);
-    void renderWallMarkers(Shader* shader);
+    // Advance the simulation by one tick.
+    void step();
+    void applyWind(float deltaTime);
+    void followTrajectories(float deltaTime);
+    void updateRoutes();
+    void updateCameras(float deltaTime);
+    void recordHistory();
+    bool seekHistory(long long target);
+    void reportStats();
 };
 
 #endif // SCENE_H
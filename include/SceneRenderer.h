@@ -0,0 +1,62 @@
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include "Scene.h"
+#include "Shader.h"
+#include "TrailRenderer.h"
+#include "SensorRenderer.h"
+#include "TerrainRenderer.h"
+#include "WorldState.h"
+#include <memory>
+#include <vector>
+
+// The render side of the world. Each frame it picks up the newest
+// WorldState published by the Scene and draws it; it never reads the live
+// simulation, so a slow frame cannot stall the simulation and vice versa.
+class SceneRenderer {
+public:
+    SceneRenderer(Scene &scene, int width, int height);
+
+    void render(Shader* shader);
+
+    // Set active camera by index: 0 - Global, 1 - Chopper, 2 - First-person.
+    void setActiveCamera(int index);
+
+    // In sensor mode every drone's cockpit view is rendered and read back each frame.
+    void setSensorMode(bool enabled);
+    bool getSensorMode() const;
+    SensorRenderer &getSensorRenderer();
+
+private:
+    Scene &scene;
+    int activeCameraIndex;
+
+    int screenWidth;
+    int screenHeight;
+
+    // Recent flight paths of every drone, sampled once per new state.
+    TrailRenderer trails;
+    std::vector<glm::vec3> trailSamples;
+    std::vector<unsigned> trailTeleports;
+
+    // Batched cockpit camera rendering for every drone.
+    SensorRenderer sensors;
+    bool sensorMode;
+    Camera sensorCamera;
+    std::vector<glm::mat4> sensorViews;
+    std::vector<glm::vec4> cullPlanes;
+    long long renderedFrames;
+
+    // Tiles of the scene's terrain streamed around the active camera, if it has one.
+    std::unique_ptr<TerrainRenderer> terrain;
+
+    void appendTrails(const WorldState &state);
+    // Draw the solid geometry (triangles only); the caller sets up the cameras.
+    // Given cull views, drones outside all of them are skipped.
+    void renderWorld(const WorldState &state, Shader* shader, const glm::mat4* cullViews = nullptr, int cullCount = 0);
+    void renderSensors(const WorldState &state);
+    void renderMarkers(Shader* shader);
+    void renderWallMarkers(Shader* shader);
+};
+
+#endif // SCENERENDERER_H
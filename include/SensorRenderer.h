@@ -0,0 +1,111 @@
+#ifndef SENSORRENDERER_H
+#define SENSORRENDERER_H
+
+#include <glm/glm.hpp>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "Shader.h"
+
+// One batch of sensor images handed to the consumer.
+struct SensorFrame {
+    long long sequence;    // Capture number, increasing by one per capture.
+    long long tick;        // Simulation tick the views were rendered at.
+    int width;
+    int height;
+    int layers;            // One layer per view, in the order the views were given.
+    int firstView;         // View in layer 0; layer i holds view (firstView + i) modulo the views given.
+    const unsigned char* pixels; // RGBA8, layer after layer. Only valid during the callback.
+    double latencySeconds; // From capture() to delivery.
+};
+
+// Renders many low-resolution views into the layers of one texture array
+// and reads the pixels back asynchronously.
+//
+// Views are rendered in batches of up to MAX_VIEWS_PER_PASS with a layered
+// geometry shader, so each batch is one pass over the world. Readback goes
+// through a ring of pixel buffer objects guarded by fences; poll() only
+// delivers buffers whose fence has already signalled, and capture() drops a
+// frame rather than wait when every buffer is still in flight.
+//
+// The number of layers is capped by GL_MAX_ARRAY_TEXTURE_LAYERS and by a
+// memory budget for the arrays and the readback ring. When more views are
+// given than fit, each capture renders the next batch of them in turn.
+class SensorRenderer {
+public:
+    // Geometry shader invocations per primitive; GL guarantees at least 32.
+    static constexpr int MAX_VIEWS_PER_PASS = 32;
+
+    // memoryBudget: upper bound, in bytes, of the texture arrays and readback buffers.
+    SensorRenderer(int width, int height, int maxViews, std::size_t memoryBudget, int ringSize = 3);
+    ~SensorRenderer();
+
+    SensorRenderer(const SensorRenderer&) = delete;
+    SensorRenderer& operator=(const SensorRenderer&) = delete;
+
+    void setConsumer(std::function<void(const SensorFrame&)> consumer);
+
+    // Render one view per view-projection matrix and start reading it back.
+    // drawWorld issues the scene's draw calls for one pass with the shader it
+    // is given; it may skip whatever lies outside all of the pass's views.
+    void capture(long long tick, const std::vector<glm::mat4> &viewProjections,
+                 const std::function<void(Shader*, const glm::mat4* passViews, int passCount)> &drawWorld);
+
+    // Deliver every completed readback to the consumer, oldest first. Never blocks.
+    void poll();
+
+    int getWidth() const;
+    int getHeight() const;
+    // Views rendered per capture; only known once the first capture has set up GL.
+    int getMaxViews() const;
+
+    // Statistics since the last resetStats().
+    double getFramesPerSecond() const;
+    double getMegabytesPerSecond() const;
+    double getAverageLatency() const;
+    long long getDroppedFrames() const;
+    void resetStats();
+
+private:
+    struct Readback {
+        unsigned int pbo;
+        void* fence;
+        long long sequence;
+        long long tick;
+        int layers;
+        int firstView;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    int width;
+    int height;
+    int maxViews;
+    std::size_t memoryBudget;
+    std::vector<Readback> ring;
+    int nextWrite;
+    int nextRead;
+    long long sequence;
+    // First view of the next capture when the views take turns.
+    int nextView;
+    std::vector<glm::mat4> passViews;
+
+    std::function<void(const SensorFrame&)> consumer;
+
+    unsigned int colorArray;
+    unsigned int depthArray;
+    unsigned int renderFBO;
+    unsigned int readFBO;
+    Shader* shader;
+
+    // Statistics.
+    std::chrono::steady_clock::time_point statsStart;
+    long long framesDelivered;
+    long long bytesDelivered;
+    long long droppedFrames;
+    double latencyTotal;
+
+    void initGL();
+};
+
+#endif // SENSORRENDERER_H
@@ -9,11 +9,15 @@ public:
     unsigned int ID;
     // Constructor builds the shader from source strings.
     Shader(const char* vertexSource, const char* fragmentSource);
+    // Constructor for programs with a geometry stage.
+    Shader(const char* vertexSource, const char* geometrySource, const char* fragmentSource);
     // Activate the shader program.
     void use();
     // Utility uniform functions.
     void setMat4(const std::string &name, const glm::mat4 &mat) const;
     void setVec3(const std::string &name, const glm::vec3 &vec) const;
+    void setInt(const std::string &name, int value) const;
+    void setFloat(const std::string &name, float value) const;
 };
 
 #endif
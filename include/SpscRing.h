@@ -0,0 +1,84 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+// Lock-free single-producer, single-consumer ring of fixed capacity.
+//
+// The ring holds its slots inline and uses no pointers, so it can be placed
+// in memory shared between processes (e.g. with placement new into a
+// MAP_SHARED mapping). The producer only writes `tail`, the consumer only
+// writes `head`; each side reads the other's index with acquire ordering.
+template <typename T, uint32_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "Slots are copied between processes");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "Indices must be lock-free to be shared");
+
+public:
+    SpscRing() : head(0), tail(0) {
+    }
+
+    // Producer side. Returns false if the ring is full.
+    bool push(const T &value) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(T &value) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // On separate cache lines so the two sides do not fight over one.
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    alignas(64) T slots[Capacity];
+};
+
+// Barrier for a fixed number of participants, usable across processes when
+// placed in shared memory. Waiters spin briefly, then yield.
+class SpinBarrier {
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "Counters must be lock-free to be shared");
+
+public:
+    explicit SpinBarrier(uint32_t participants) : participants(participants), arrived(0), generation(0) {
+    }
+
+    void arriveAndWait() {
+        uint32_t current = generation.load(std::memory_order_acquire);
+        if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == participants) {
+            // Last to arrive: reset for the next round, then release the others.
+            arrived.store(0, std::memory_order_relaxed);
+            generation.store(current + 1, std::memory_order_release);
+            return;
+        }
+        int spins = 0;
+        while (generation.load(std::memory_order_acquire) == current) {
+            if (++spins > SPIN_LIMIT)
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr int SPIN_LIMIT = 1000;
+
+    const uint32_t participants;
+    alignas(64) std::atomic<uint32_t> arrived;
+    alignas(64) std::atomic<uint32_t> generation;
+};
+
+#endif // SPSCRING_H
@@ -0,0 +1,155 @@
+#ifndef TELEMETRYSTORE_H
+#define TELEMETRYSTORE_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// On-disk store of recorded flight telemetry: one row per drone per tick.
+//
+// Rows are grouped into blocks of up to TELEMETRY_BLOCK_ROWS. Each block is
+// a header followed by its columns (time, drone, position x/y/z, rotation
+// x/y/z), each stored contiguously. The header summarises the block with
+// the min/max of time, drone index, position and rotation, which serves as
+// a sparse index: queries skip whole blocks from their headers alone and
+// only read the columns they need from the blocks they cannot skip. Rows
+// within a block are ordered by drone, then time.
+const int TELEMETRY_BLOCK_ROWS = 4096;
+
+// Appends telemetry to a store file. Rows are buffered in a window of
+// several blocks' worth of ticks, then sorted by drone before the window is
+// cut into blocks, so each block holds one or a few drones rather than a few
+// ticks of the whole fleet.
+class TelemetryWriter {
+public:
+    TelemetryWriter();
+    ~TelemetryWriter();
+
+    // Create (or truncate) the file. Returns false if it cannot be written.
+    bool open(const std::string &path);
+    bool isOpen() const;
+
+    // Add one row: a drone's pose at the given simulation time.
+    void append(double time, uint32_t drone, const glm::vec3 &position, const glm::vec3 &rotation);
+
+    // Write out the buffered window and close the file.
+    void close();
+
+    long long getRowsWritten() const;
+
+private:
+    std::ofstream file;
+    long long rowsWritten;
+
+    // Columns of the window being filled, in arrival order.
+    std::vector<double> times;
+    std::vector<uint32_t> droneIndices;
+    std::vector<float> columns[6];
+
+    // The window's rows in block order, and the columns of the block being written.
+    std::vector<uint32_t> order;
+    std::vector<double> blockTimes;
+    std::vector<uint32_t> blockDrones;
+    std::vector<float> blockColumns[6];
+
+    void flushWindow();
+    void writeBlock(const uint32_t* rowOrder, uint32_t rows);
+};
+
+// Counters reported by every query.
+struct TelemetryQueryStats {
+    int blocksTotal;
+    int blocksScanned;
+    long long rowsScanned;
+    long long rowsReturned;
+    std::size_t bytesRead;
+};
+
+// A drone that came within the query radius, and when.
+struct ProximityResult {
+    uint32_t drone;
+    double firstTime;
+    double lastTime;
+    float closestDistance;
+    long long rows;
+};
+
+// The highest pitch reached by a drone, and when.
+struct PitchResult {
+    uint32_t drone;
+    float maxPitch;
+    double time;
+};
+
+// Read-only view of a store file, memory-mapped so queries only page in the
+// block headers and the columns they touch.
+class TelemetryReader {
+public:
+    TelemetryReader();
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    // Map the file and read its block headers. A block cut short by a crash ends the file.
+    bool open(const std::string &path);
+    void close();
+
+    int getBlockCount() const;
+    long long getRowCount() const;
+    double getMinTime() const;
+    double getMaxTime() const;
+
+    // Drones within `radius` of `point` at any time in [t1, t2].
+    std::vector<ProximityResult> findNear(const glm::vec3 &point, float radius, double t1, double t2,
+                                          TelemetryQueryStats &stats) const;
+
+    // Maximum pitch of every drone over [t1, t2].
+    std::vector<PitchResult> findMaxPitch(double t1, double t2, TelemetryQueryStats &stats) const;
+
+private:
+    struct BlockHeader {
+        uint32_t magic;
+        uint32_t rows;
+        double minTime;
+        double maxTime;
+        uint32_t minDrone;
+        uint32_t maxDrone;
+        float minPosition[3];
+        float maxPosition[3];
+        float minRotation[3];
+        float maxRotation[3];
+    };
+
+    struct Block {
+        BlockHeader header;
+        std::size_t offset; // Of the first column.
+    };
+
+    const unsigned char* data;
+    std::size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+    std::vector<Block> blocks;
+    long long rowCount;
+    uint32_t droneCount;
+
+    friend class TelemetryWriter;
+
+    // Byte offset of a column within a block of `rows` rows, and the size of all columns.
+    static std::size_t columnOffset(int column, uint32_t rows);
+    static std::size_t blockBytes(uint32_t rows);
+
+    template <typename T>
+    const T* column(const Block &block, int index, TelemetryQueryStats &stats) const;
+};
+
+#endif // TELEMETRYSTORE_H
@@ -0,0 +1,71 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A heightmap terrain read from a memory-mapped file.
+//
+// The map is split into square tiles of TILE_QUADS x TILE_QUADS quads. Each
+// tile is stored as one contiguous block of TILE_SAMPLES x TILE_SAMPLES
+// 16-bit heights, including the samples it shares with its neighbours, so
+// reading a tile only pages in that tile's part of the file. The map is
+// centred on the origin in x and z.
+class TerrainMap {
+public:
+    static constexpr int TILE_QUADS = 64;
+    static constexpr int TILE_SAMPLES = TILE_QUADS + 1;
+
+    TerrainMap();
+    ~TerrainMap();
+
+    TerrainMap(const TerrainMap&) = delete;
+    TerrainMap& operator=(const TerrainMap&) = delete;
+
+    // Write a procedural map of rolling hills and ridges, `spacing` metres
+    // between samples. Returns false if the file cannot be written.
+    static bool generate(const std::string &path, int tilesX, int tilesZ, float spacing, uint32_t seed);
+
+    // Returns false if the file is missing or not a terrain map.
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const;
+
+    int getTilesX() const;
+    int getTilesZ() const;
+    float getSpacing() const;
+    float getTileSize() const;
+    // Corners of the map; y spans the lowest to the highest possible height.
+    glm::vec3 getMin() const;
+    glm::vec3 getMax() const;
+    // World x and z of a tile's lowest corner.
+    glm::vec2 getTileOrigin(int tileX, int tileZ) const;
+
+    // Height of a sample by its index over the whole map, clamped to the map.
+    float getSampleHeight(int sampleX, int sampleZ) const;
+    // Height of the ground below a point, interpolated between samples.
+    // Points beyond the edge get the height of the nearest edge.
+    float heightAt(float x, float z) const;
+
+    std::size_t getFileSize() const;
+
+private:
+    const unsigned char* data;
+    std::size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+    const uint16_t* heights; // First tile.
+    int tilesX, tilesZ;
+    float spacing;
+    float minHeight, heightStep;
+    glm::vec2 origin;
+};
+
+#endif // TERRAIN_H
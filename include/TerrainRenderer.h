@@ -0,0 +1,115 @@
+#ifndef TERRAINRENDERER_H
+#define TERRAINRENDERER_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Shader.h"
+#include "Terrain.h"
+#include "ThreadPool.h"
+
+// Streams the tiles of a TerrainMap around the camera.
+//
+// Every frame the tiles within VIEW_DISTANCE of the camera are
+// wanted, each at a level of detail chosen by its distance: level n keeps
+// every 2^n-th sample. Meshes are built on background threads from the
+// memory-mapped heights and uploaded on the render thread, at most a few per
+// frame, into a GPU cache of tile meshes. The least recently drawn meshes are
+// evicted once the cache exceeds its memory budget. Until a tile's mesh at
+// the wanted level is ready, any other level already cached is drawn
+// instead. Tiles carry a skirt hanging below their edges, which hides the
+// cracks between neighbours at different levels.
+class TerrainRenderer {
+public:
+    static constexpr int LOD_LEVELS = 4;
+    // Tiles further than this from the camera, in metres, are not drawn.
+    static constexpr float VIEW_DISTANCE = 1200.0f;
+
+    // memoryBudget: upper bound, in bytes, of cached tile meshes on the GPU.
+    TerrainRenderer(const TerrainMap &map, std::size_t memoryBudget);
+    // Waits for the meshes still being built.
+    ~TerrainRenderer();
+
+    TerrainRenderer(const TerrainRenderer&) = delete;
+    TerrainRenderer& operator=(const TerrainRenderer&) = delete;
+
+    // Upload finished meshes, request missing ones and draw the visible tiles.
+    void render(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition);
+
+    // Statistics of the last render().
+    int getDrawnTiles() const;
+    int getUploads() const;
+    int getPendingBuilds() const;
+    int getCachedTiles() const;
+    std::size_t getMemoryUsage() const;
+    // Evictions since construction.
+    long long getEvictions() const;
+
+private:
+    // A tile mesh on the GPU.
+    struct CachedTile {
+        unsigned int vao;
+        unsigned int vbo;
+        int level;
+        std::size_t bytes;
+        long long lastFrame;
+        std::list<uint64_t>::iterator recent;
+    };
+
+    // A mesh built on a worker: interleaved positions and normals.
+    struct BuiltTile {
+        uint64_t key;
+        std::vector<float> vertices;
+    };
+
+    const TerrainMap &map;
+    std::size_t memoryBudget;
+
+    // Cache keyed by tile and level; `recentlyUsed` runs from the most to the least recently drawn.
+    std::unordered_map<uint64_t, CachedTile> cache;
+    std::list<uint64_t> recentlyUsed;
+    std::size_t cachedBytes;
+    long long frame;
+    long long evictions;
+
+    // Keys being built, and the meshes finished but not yet uploaded.
+    std::unordered_set<uint64_t> building;
+    std::mutex finishedMutex;
+    std::vector<BuiltTile> finished;
+    std::vector<BuiltTile> uploading;
+
+    struct WantedTile {
+        int tileX, tileZ, level;
+        float distance;
+    };
+    std::vector<WantedTile> wanted;
+    std::unordered_set<uint64_t> wantedKeys;
+
+    // Index buffers are shared by every tile of the same level.
+    unsigned int indexBuffers[LOD_LEVELS];
+    int indexCounts[LOD_LEVELS];
+    Shader* shader;
+
+    int drawnTiles;
+    int uploads;
+
+    // Declared last so its threads finish before the state above goes away.
+    ThreadPool builders;
+
+    static uint64_t makeKey(int tileX, int tileZ, int level);
+    void initGL();
+    void collectWanted(const glm::vec3 &cameraPosition);
+    void uploadFinished();
+    void requestBuild(int tileX, int tileZ, int level);
+    // The cached mesh to draw for a tile, preferring the wanted level, then the closest one.
+    CachedTile* findDrawable(int tileX, int tileZ, int level);
+    void evict();
+    void buildMesh(int tileX, int tileZ, int level, std::vector<float> &vertices) const;
+};
+
+#endif // TERRAINRENDERER_H
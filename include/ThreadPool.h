@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the simulation subsystems.
+// Threads are only started on first use, so a pool that is never used
+// (e.g. in a headless run with sensors disabled) costs nothing.
+class ThreadPool {
+public:
+    // threadCount == 0 uses one thread per hardware core.
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a job to run asynchronously on a worker.
+    void submit(std::function<void()> job);
+
+    // Split [0, count) into chunks and run fn(begin, end) on the workers and
+    // the calling thread. Returns once every chunk has completed.
+    void parallelFor(int count, const std::function<void(int, int)> &fn);
+
+    int getThreadCount() const;
+
+private:
+    int threadCount;
+    bool stopping;
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+
+    void start();
+    void workerLoop();
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,70 @@
+#ifndef TRAILRENDERER_H
+#define TRAILRENDERER_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include "Shader.h"
+
+// Flight trails for a fleet of drones.
+//
+// Every drone owns a fixed-capacity circular history of positions. All
+// histories live in one GPU buffer laid out row by row: row k holds sample
+// slot k of every drone, so appending the newest sample of the whole fleet
+// is a single contiguous upload. The buffer is read through a texture
+// buffer and the vertex shader resolves ring wraparound itself, so no data
+// is ever moved once written. All trails are drawn with one
+// glMultiDrawArrays call of line strips.
+class TrailRenderer {
+public:
+    // maxDrones:      number of trail slots to reserve.
+    // seconds:        history length to keep per drone.
+    // sampleInterval: time between two consecutive samples.
+    // memoryBudget:   upper bound, in bytes, of the GPU history buffer.
+    TrailRenderer(int maxDrones, float seconds, float sampleInterval, std::size_t memoryBudget);
+    ~TrailRenderer();
+
+    TrailRenderer(const TrailRenderer&) = delete;
+    TrailRenderer& operator=(const TrailRenderer&) = delete;
+
+    // Append the newest sample of each drone. Drones beyond maxDrones are ignored.
+    void append(const std::vector<glm::vec3> &positions);
+
+    // Forget the history of one drone, e.g. after it was teleported.
+    void clear(int droneIndex);
+
+    // Upload pending samples and draw every trail.
+    void render(const glm::mat4 &view, const glm::mat4 &projection);
+
+    // Number of samples kept per drone.
+    int getCapacity() const;
+
+private:
+    int maxDrones;
+    int capacity;
+    int activeDrones;
+
+    // Total number of rows appended so far, and how many of them are on the GPU.
+    long long rowsAppended;
+    long long rowsUploaded;
+
+    // Rows appended since the last upload, oldest first.
+    std::vector<glm::vec3> pendingRows;
+
+    // Number of valid samples per drone, capped at capacity.
+    std::vector<int> validSamples;
+
+    // Scratch arrays for glMultiDrawArrays.
+    std::vector<int> drawFirsts;
+    std::vector<int> drawCounts;
+
+    unsigned int historyBuffer;
+    unsigned int historyTexture;
+    unsigned int emptyVAO;
+    Shader* shader;
+
+    void initGL();
+    void uploadPending();
+};
+
+#endif // TRAILRENDERER_H
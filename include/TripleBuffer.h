@@ -0,0 +1,52 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Lock-free single-producer, single-consumer triple buffer.
+//
+// The producer fills the back slot and publishes it by swapping it with the
+// middle slot. The consumer swaps the middle slot with its front slot only
+// when something new was published. Neither side ever waits for the other,
+// and the consumer always sees the latest complete value, never a torn one.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : back(0), middle(1), front(2) {
+    }
+
+    // Producer side: the slot to fill before the next publish().
+    T &getWriteBuffer() {
+        return slots[back];
+    }
+
+    // Producer side: make the write buffer the latest value.
+    void publish() {
+        unsigned previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    // Consumer side: the latest published value. `updated` is set when it
+    // differs from the one returned by the previous call.
+    const T &acquire(bool* updated = nullptr) {
+        bool fresh = (middle.load(std::memory_order_relaxed) & FRESH) != 0;
+        if (fresh) {
+            unsigned previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & INDEX_MASK;
+        }
+        if (updated)
+            *updated = fresh;
+        return slots[front];
+    }
+
+private:
+    static const unsigned INDEX_MASK = 3;
+    static const unsigned FRESH = 4;
+
+    T slots[3];
+    unsigned back;                // Owned by the producer.
+    std::atomic<unsigned> middle; // Shared: slot index plus the FRESH flag.
+    unsigned front;               // Owned by the consumer.
+};
+
+#endif // TRIPLEBUFFER_H
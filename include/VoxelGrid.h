@@ -0,0 +1,55 @@
+#ifndef VOXELGRID_H
+#define VOXELGRID_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "Bvh.h"
+
+// Occupancy of a box-shaped volume on a regular grid of cubic cells.
+//
+// A grid is filled once and then shared read-only, typically through a
+// std::shared_ptr<const VoxelGrid>: a new occupancy is published as a new
+// grid with a higher version, so planners on other threads keep a
+// consistent snapshot for as long as they hold on to it.
+class VoxelGrid {
+public:
+    enum Cell : uint8_t { FREE = 0, OBSTACLE = 1, DRONE = 2 };
+
+    VoxelGrid(const glm::vec3 &min, const glm::vec3 &max, float cellSize);
+
+    // Mark every cell whose centre lies within `inflate` of a box, so a
+    // sphere of that radius at any free cell centre clears the boxes.
+    void addObstacles(const std::vector<Aabb> &boxes, float inflate);
+    // Mark the cells holding drones, leaving obstacle cells as they are.
+    void addDrones(const std::vector<glm::vec3> &positions);
+
+    void setVersion(long long version);
+    long long getVersion() const;
+
+    int getSizeX() const;
+    int getSizeY() const;
+    int getSizeZ() const;
+    int getCellCount() const;
+    float getCellSize() const;
+
+    // Index of the cell containing a point; points outside are clamped to the grid.
+    int cellAt(const glm::vec3 &position) const;
+    glm::vec3 cellCentre(int cell) const;
+    Cell get(int cell) const;
+    // Every cell in index order, for searches that walk the grid directly.
+    const uint8_t* getCells() const;
+
+    // Cells whose occupancy differs from another grid of the same size.
+    void diff(const VoxelGrid &other, std::vector<int> &changed) const;
+
+private:
+    glm::vec3 origin;
+    float cellSize;
+    int sizeX, sizeY, sizeZ;
+    long long version;
+    // x fastest, then z, then y.
+    std::vector<uint8_t> cells;
+};
+
+#endif // VOXELGRID_H
@@ -0,0 +1,19 @@
+#ifndef WORLDSTATE_H
+#define WORLDSTATE_H
+
+#include <vector>
+#include "Drone.h"
+#include "Camera.h"
+
+// Immutable copy of everything the render thread needs from one simulation
+// tick. Published by Scene through a triple buffer.
+struct WorldState {
+    long long tick = 0;
+    std::vector<Drone> drones;
+    // Global, chopper and first-person cameras as placed by the simulation.
+    std::vector<Camera> cameras;
+    // Bumped whenever a drone is teleported (reset or rewind), so trails can be cut.
+    std::vector<unsigned> teleports;
+};
+
+#endif // WORLDSTATE_H
@@ -0,0 +1,265 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
+// Primitives per leaf before a node is split.
+static const int MAX_LEAF_SIZE = 2;
+// Deep enough for any tree built from a median split over 2^32 primitives.
+static const int TRAVERSAL_STACK_SIZE = 64;
+
+// Reciprocal of a direction component that never produces inf * 0 = NaN.
+static inline float safeInverse(float d) {
+    if (std::fabs(d) < 1e-12f)
+        return std::copysign(1e30f, d);
+    return 1.0f / d;
+}
+
+// Four lanes of a ray packet in one SIMD register: SSE2 on x86-64, NEON on
+// AArch64, and a plain array elsewhere.
+#if defined(__SSE2__) || defined(_M_X64)
+typedef __m128 Lanes4;
+static inline Lanes4 lanesLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline Lanes4 lanesSet(float v) { return _mm_set1_ps(v); }
+static inline Lanes4 lanesSub(Lanes4 a, Lanes4 b) { return _mm_sub_ps(a, b); }
+static inline Lanes4 lanesMul(Lanes4 a, Lanes4 b) { return _mm_mul_ps(a, b); }
+static inline Lanes4 lanesMin(Lanes4 a, Lanes4 b) { return _mm_min_ps(a, b); }
+static inline Lanes4 lanesMax(Lanes4 a, Lanes4 b) { return _mm_max_ps(a, b); }
+// Stores `a` where a <= b and +inf elsewhere; returns whether any lane stored `a`.
+static inline bool lanesStoreIfLessEqual(Lanes4 a, Lanes4 b, float* out) {
+    __m128 mask = _mm_cmple_ps(a, b);
+    _mm_storeu_ps(out, _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, _mm_set1_ps(INFINITY))));
+    return _mm_movemask_ps(mask) != 0;
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+typedef float32x4_t Lanes4;
+static inline Lanes4 lanesLoad(const float* p) { return vld1q_f32(p); }
+static inline Lanes4 lanesSet(float v) { return vdupq_n_f32(v); }
+static inline Lanes4 lanesSub(Lanes4 a, Lanes4 b) { return vsubq_f32(a, b); }
+static inline Lanes4 lanesMul(Lanes4 a, Lanes4 b) { return vmulq_f32(a, b); }
+static inline Lanes4 lanesMin(Lanes4 a, Lanes4 b) { return vminq_f32(a, b); }
+static inline Lanes4 lanesMax(Lanes4 a, Lanes4 b) { return vmaxq_f32(a, b); }
+static inline bool lanesStoreIfLessEqual(Lanes4 a, Lanes4 b, float* out) {
+    uint32x4_t mask = vcleq_f32(a, b);
+    vst1q_f32(out, vbslq_f32(mask, a, vdupq_n_f32(INFINITY)));
+    return vmaxvq_u32(mask) != 0;
+}
+#else
+struct Lanes4 {
+    float v[4];
+};
+static inline Lanes4 lanesLoad(const float* p) { return Lanes4{{p[0], p[1], p[2], p[3]}}; }
+static inline Lanes4 lanesSet(float v) { return Lanes4{{v, v, v, v}}; }
+static inline Lanes4 lanesSub(Lanes4 a, Lanes4 b) {
+    for (int i = 0; i < 4; i++)
+        a.v[i] -= b.v[i];
+    return a;
+}
+static inline Lanes4 lanesMul(Lanes4 a, Lanes4 b) {
+    for (int i = 0; i < 4; i++)
+        a.v[i] *= b.v[i];
+    return a;
+}
+static inline Lanes4 lanesMin(Lanes4 a, Lanes4 b) {
+    for (int i = 0; i < 4; i++)
+        a.v[i] = std::min(a.v[i], b.v[i]);
+    return a;
+}
+static inline Lanes4 lanesMax(Lanes4 a, Lanes4 b) {
+    for (int i = 0; i < 4; i++)
+        a.v[i] = std::max(a.v[i], b.v[i]);
+    return a;
+}
+static inline bool lanesStoreIfLessEqual(Lanes4 a, Lanes4 b, float* out) {
+    bool any = false;
+    for (int i = 0; i < 4; i++) {
+        out[i] = a.v[i] <= b.v[i] ? a.v[i] : INFINITY;
+        any |= a.v[i] <= b.v[i];
+    }
+    return any;
+}
+#endif
+
+static_assert(RAY_PACKET_SIZE % 4 == 0, "Packets are traced four lanes at a time");
+
+Bvh::Bvh() {
+}
+
+bool Bvh::isEmpty() const {
+    return primitives.empty();
+}
+
+void Bvh::build(const std::vector<Aabb> &boxes) {
+    primitives = boxes;
+    nodes.clear();
+    indices.resize(primitives.size());
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = static_cast<int>(i);
+    if (primitives.empty())
+        return;
+
+    nodes.reserve(primitives.size() * 2);
+    nodes.push_back(Node());
+    subdivide(0, 0, static_cast<int>(primitives.size()));
+}
+
+void Bvh::subdivide(int nodeIndex, int first, int count) {
+    glm::vec3 boundsMin(1e30f), boundsMax(-1e30f);
+    glm::vec3 centroidMin(1e30f), centroidMax(-1e30f);
+    for (int i = first; i < first + count; i++) {
+        const Aabb &box = primitives[indices[i]];
+        boundsMin = glm::min(boundsMin, box.min);
+        boundsMax = glm::max(boundsMax, box.max);
+        glm::vec3 centroid = (box.min + box.max) * 0.5f;
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+    nodes[nodeIndex].min = boundsMin;
+    nodes[nodeIndex].max = boundsMax;
+
+    if (count <= MAX_LEAF_SIZE) {
+        nodes[nodeIndex].leftOrFirst = first;
+        nodes[nodeIndex].count = count;
+        return;
+    }
+
+    // Median split along the axis with the widest spread of centroids.
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+    int half = count / 2;
+    std::nth_element(indices.begin() + first, indices.begin() + first + half, indices.begin() + first + count,
+                     [&](int a, int b) {
+                         return primitives[a].min[axis] + primitives[a].max[axis] <
+                                primitives[b].min[axis] + primitives[b].max[axis];
+                     });
+
+    // Children are stored next to each other; nodes may reallocate, so index rather than reference.
+    int left = static_cast<int>(nodes.size());
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    nodes[nodeIndex].leftOrFirst = left;
+    nodes[nodeIndex].count = 0;
+    subdivide(left, first, half);
+    subdivide(left + 1, first + half, count - half);
+}
+
+bool Bvh::intersect(const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float inflate, RayHit &hit) const {
+    if (nodes.empty())
+        return false;
+
+    glm::vec3 invDir(safeInverse(dir.x), safeInverse(dir.y), safeInverse(dir.z));
+    bool found = false;
+    float closest = tMax;
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        glm::vec3 t1 = (node.min - inflate - origin) * invDir;
+        glm::vec3 t2 = (node.max + inflate - origin) * invDir;
+        glm::vec3 tNear = glm::min(t1, t2), tFar = glm::max(t1, t2);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, closest));
+        if (enter > exit)
+            continue;
+
+        if (node.count == 0) {
+            stack[top++] = node.leftOrFirst;
+            stack[top++] = node.leftOrFirst + 1;
+            continue;
+        }
+
+        for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+            const Aabb &box = primitives[indices[i]];
+            glm::vec3 b1 = (box.min - inflate - origin) * invDir;
+            glm::vec3 b2 = (box.max + inflate - origin) * invDir;
+            glm::vec3 bNear = glm::min(b1, b2), bFar = glm::max(b1, b2);
+            float boxEnter = std::max(std::max(bNear.x, bNear.y), bNear.z);
+            float boxExit = std::min(std::min(bFar.x, bFar.y), bFar.z);
+            // A negative entry means the origin is already inside; let it move out freely.
+            if (boxEnter < 0.0f || boxEnter > boxExit || boxEnter > closest)
+                continue;
+
+            int axis = 0;
+            if (bNear.y > bNear[axis]) axis = 1;
+            if (bNear.z > bNear[axis]) axis = 2;
+            hit.normal = glm::vec3(0.0f);
+            hit.normal[axis] = dir[axis] > 0.0f ? -1.0f : 1.0f;
+            hit.primitive = indices[i];
+            hit.distance = boxEnter;
+            closest = boxEnter;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void Bvh::intersectPacket(RayPacket &packet) const {
+    const int N = RAY_PACKET_SIZE;
+    float invX[N], invY[N], invZ[N];
+    for (int l = 0; l < N; l++) {
+        invX[l] = safeInverse(packet.dirX[l]);
+        invY[l] = safeInverse(packet.dirY[l]);
+        invZ[l] = safeInverse(packet.dirZ[l]);
+        packet.primitive[l] = -1;
+    }
+    if (nodes.empty())
+        return;
+
+    // Entry distance of each lane into the box passed to slabs(); lanes that
+    // miss it, or only reach it beyond their current closest hit, get +inf.
+    float enter[N];
+    auto slabs = [&](const glm::vec3 &bmin, const glm::vec3 &bmax) {
+        Lanes4 minX = lanesSet(bmin.x), minY = lanesSet(bmin.y), minZ = lanesSet(bmin.z);
+        Lanes4 maxX = lanesSet(bmax.x), maxY = lanesSet(bmax.y), maxZ = lanesSet(bmax.z);
+        Lanes4 zero = lanesSet(0.0f);
+        bool anyHit = false;
+        for (int l = 0; l < N; l += 4) {
+            Lanes4 ox = lanesLoad(packet.originX + l), oy = lanesLoad(packet.originY + l), oz = lanesLoad(packet.originZ + l);
+            Lanes4 ix = lanesLoad(invX + l), iy = lanesLoad(invY + l), iz = lanesLoad(invZ + l);
+            Lanes4 x1 = lanesMul(lanesSub(minX, ox), ix), x2 = lanesMul(lanesSub(maxX, ox), ix);
+            Lanes4 y1 = lanesMul(lanesSub(minY, oy), iy), y2 = lanesMul(lanesSub(maxY, oy), iy);
+            Lanes4 z1 = lanesMul(lanesSub(minZ, oz), iz), z2 = lanesMul(lanesSub(maxZ, oz), iz);
+            Lanes4 tNear = lanesMax(lanesMax(lanesMin(x1, x2), lanesMin(y1, y2)), lanesMax(lanesMin(z1, z2), zero));
+            Lanes4 tFar = lanesMin(lanesMin(lanesMax(x1, x2), lanesMax(y1, y2)),
+                                   lanesMin(lanesMax(z1, z2), lanesLoad(packet.tMax + l)));
+            anyHit |= lanesStoreIfLessEqual(tNear, tFar, enter + l);
+        }
+        return anyHit;
+    };
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        if (!slabs(node.min, node.max))
+            continue;
+
+        if (node.count == 0) {
+            stack[top++] = node.leftOrFirst;
+            stack[top++] = node.leftOrFirst + 1;
+            continue;
+        }
+
+        for (int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+            const Aabb &box = primitives[indices[i]];
+            if (!slabs(box.min, box.max))
+                continue;
+            int primitive = indices[i];
+            for (int l = 0; l < N; l++) {
+                bool closer = enter[l] < packet.tMax[l];
+                packet.tMax[l] = closer ? enter[l] : packet.tMax[l];
+                packet.primitive[l] = closer ? primitive : packet.primitive[l];
+            }
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include "Drone.h"
 #include <cmath>
 
 Camera::Camera(CameraType type) : type(type),
@@ -46,10 +47,38 @@ void Camera::setUp(const glm::vec3 &u) {
     up = u;
 }
 
+void Camera::setAspectRatio(float aspect) {
+    aspectRatio = aspect;
+}
+
+void Camera::setFarClip(float distance) {
+    farClip = distance;
+}
+
+glm::vec3 Camera::getPosition() const {
+    return position;
+}
+
 CameraType Camera::getType() const {
     return type;
 }
 
+void Camera::followCockpit(const Drone &drone) {
+    // Adjust the offset
+    glm::vec3 cockpitOffset = glm::vec3(0.0f, 0.3f, -0.5f);
+    float yaw = glm::radians(drone.getRotation().y);
+    glm::mat4 rotationMat = glm::rotate(glm::mat4(1.0f), yaw, glm::vec3(0, 1, 0));
+    glm::vec3 rotatedOffset = glm::vec3(rotationMat * glm::vec4(cockpitOffset, 1.0f));
+
+    position = drone.getPosition() + rotatedOffset;
+    // The target for the cockpit camera is set in the drone's forward direction.
+    target = drone.getPosition() + drone.getFront();
+}
+
 void Camera::setAngle(float a) {
     angle = a;
 }
+
+float Camera::getAngle() const {
+    return angle;
+}
@@ -1,4 +1,5 @@
 #include "Drone.h"
+#include "Profiler.h"
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <cmath>
@@ -101,12 +102,14 @@ static void initQuad() {
     glBindVertexArray(0);
 }
 
-Drone::Drone() : position(0.0f, 2.0f, 0.0f), rotation(0.0f),
-                 propellerSpeed(100.0f), isRolling(false), rollAngle(0.0f), currentPropellerAngle(0.0f)
+// Mass of the drone, and how strongly its flight controller brakes any drift (per second).
+static const float DRONE_MASS = 1.5f;
+static const float DRIFT_DAMPING = 1.0f;
+
+Drone::Drone(const glm::vec3 &home) : home(home), position(home), rotation(0.0f), velocity(0.0f), force(0.0f),
+                 propellerSpeed(100.0f), turnRate(5.0f), isRolling(false), rollAngle(0.0f), currentPropellerAngle(0.0f)
 {
-    // Ensure geometry is initialised.
-    initCube();
-    initQuad();
+    // Geometry is created on first render, so drones can be simulated without a GL context.
 }
 
 void Drone::update(float deltaTime) {
@@ -124,10 +127,20 @@ void Drone::update(float deltaTime) {
             isRolling = false;
         }
     }
+
+    // Integrate external forces; the flight controller damps the resulting drift.
+    velocity += (force / DRONE_MASS - velocity * DRIFT_DAMPING) * deltaTime;
+    position += velocity * deltaTime;
+    force = glm::vec3(0.0f);
 }
 
 
-void Drone::render(Shader* shader) {
+void Drone::render(Shader* shader) const {
+    PROFILE_ZONE("Drone::render");
+    // Ensure geometry is initialised.
+    initCube();
+    initQuad();
+
     // Render the drone parts using the shader.
     renderBody(shader);
     renderPropeller(shader, glm::vec3(1.0f, 0.5f, 0.0f));  // Right propeller.
@@ -144,6 +157,22 @@ void Drone::decreasePropellerSpeed() {
         propellerSpeed -= 10.0f;
 }
 
+void Drone::setPropellerSpeed(float speed) {
+    propellerSpeed = speed;
+}
+
+float Drone::getPropellerSpeed() const {
+    return propellerSpeed;
+}
+
+void Drone::setTurnRate(float degrees) {
+    turnRate = degrees;
+}
+
+float Drone::getTurnRate() const {
+    return turnRate;
+}
+
 void Drone::roll() {
     isRolling = true;
     rollAngle = 0.0f;
@@ -160,24 +189,26 @@ void Drone::moveBackward() {
 }
 
 void Drone::turnLeft() {
-    rotation.y += 5.0f;
+    rotation.y += turnRate;
 }
 
 void Drone::turnRight() {
-    rotation.y -= 5.0f;
+    rotation.y -= turnRate;
 }
 
 void Drone::turnUp() {
-    rotation.x += 5.0f;
+    rotation.x += turnRate;
 }
 
 void Drone::turnDown() {
-    rotation.x -= 5.0f;
+    rotation.x -= turnRate;
 }
 
 void Drone::reset() {
-    position = glm::vec3(0.0f, 2.0f, 0.0f);
+    position = home;
     rotation = glm::vec3(0.0f);
+    velocity = glm::vec3(0.0f);
+    force = glm::vec3(0.0f);
     rollAngle = 0.0f;
     isRolling = false;
 }
@@ -186,10 +217,64 @@ glm::vec3 Drone::getPosition() const {
     return position;
 }
 
+void Drone::setPosition(const glm::vec3 &pos) {
+    position = pos;
+}
+
 glm::vec3 Drone::getRotation() const {
     return rotation;
 }
 
+void Drone::setRotation(const glm::vec3 &rot) {
+    rotation = rot;
+}
+
+glm::vec3 Drone::getHome() const {
+    return home;
+}
+
+bool Drone::isPerformingRoll() const {
+    return isRolling;
+}
+
+void Drone::applyForce(const glm::vec3 &f) {
+    force += f;
+}
+
+glm::vec3 Drone::getVelocity() const {
+    return velocity;
+}
+
+void Drone::setVelocity(const glm::vec3 &vel) {
+    velocity = vel;
+}
+
+void Drone::saveState(float* state) const {
+    const glm::vec3* vectors[] = { &home, &position, &rotation, &velocity, &force };
+    for (const glm::vec3* v : vectors) {
+        *state++ = v->x;
+        *state++ = v->y;
+        *state++ = v->z;
+    }
+    *state++ = propellerSpeed;
+    *state++ = turnRate;
+    *state++ = rollAngle;
+    *state = isRolling ? 1.0f : 0.0f;
+}
+
+void Drone::restoreState(const float* state) {
+    glm::vec3* vectors[] = { &home, &position, &rotation, &velocity, &force };
+    for (glm::vec3* v : vectors) {
+        v->x = *state++;
+        v->y = *state++;
+        v->z = *state++;
+    }
+    propellerSpeed = *state++;
+    turnRate = *state++;
+    rollAngle = *state++;
+    isRolling = *state != 0.0f;
+}
+
 glm::vec3 Drone::getFront() const {
     float yaw = rotation.y;
     float pitch = rotation.x;
@@ -202,7 +287,7 @@ glm::vec3 Drone::getFront() const {
 
 
 // Helper function: draw a cube given a model matrix and color.
-void Drone::drawCube(Shader* shader, const glm::mat4 &model, const glm::vec3 &color) {
+void Drone::drawCube(Shader* shader, const glm::mat4 &model, const glm::vec3 &color) const {
     shader->setMat4("model", model);
     shader->setVec3("objectColor", color);
     glBindVertexArray(cubeVAO);
@@ -211,7 +296,7 @@ void Drone::drawCube(Shader* shader, const glm::mat4 &model, const glm::vec3 &co
 }
 
 // Helper function: draw a quad given a model matrix and color.
-void Drone::drawQuad(Shader* shader, const glm::mat4 &model, const glm::vec3 &color) {
+void Drone::drawQuad(Shader* shader, const glm::mat4 &model, const glm::vec3 &color) const {
     shader->setMat4("model", model);
     shader->setVec3("objectColor", color);
     glBindVertexArray(quadVAO);
@@ -219,7 +304,8 @@ void Drone::drawQuad(Shader* shader, const glm::mat4 &model, const glm::vec3 &co
     glBindVertexArray(0);
 }
 
-void Drone::renderBody(Shader* shader) {
+void Drone::renderBody(Shader* shader) const {
+    PROFILE_ZONE("Drone::renderBody");
     // Create a base transformation using the drone's position and rotation.
     glm::mat4 baseModel = glm::mat4(1.0f);
     baseModel = glm::translate(baseModel, position);
@@ -237,7 +323,8 @@ void Drone::renderBody(Shader* shader) {
     drawCube(shader, cockpitModel, glm::vec3(0.8f, 0.2f, 0.2f));
 }
 
-void Drone::renderPropeller(Shader* shader, const glm::vec3 &offset) {
+void Drone::renderPropeller(Shader* shader, const glm::vec3 &offset) const {
+    PROFILE_ZONE("Drone::renderPropeller");
     glm::mat4 baseModel = glm::mat4(1.0f);
     // Apply the drone's position and rotation.
     baseModel = glm::translate(baseModel, position);
@@ -261,7 +348,8 @@ void Drone::renderPropeller(Shader* shader, const glm::vec3 &offset) {
     }
 }
 
-void Drone::renderLandingGear(Shader* shader) {
+void Drone::renderLandingGear(Shader* shader) const {
+    PROFILE_ZONE("Drone::renderLandingGear");
     // Create a base transformation from the drone's position and rotation.
     glm::mat4 baseModel = glm::mat4(1.0f);
     baseModel = glm::translate(baseModel, position);
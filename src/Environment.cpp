@@ -0,0 +1,143 @@
+#include "Environment.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+
+// Static variables for cube geometry.
+static unsigned int cubeVAO = 0, cubeVBO = 0;
+
+static void initCube() {
+    if (cubeVAO != 0)
+        return;
+    float cubeVertices[] = {
+            // positions (unit cube centred on the origin)
+            -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,
+
+            -0.5f, -0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,   0.5f,  0.5f, -0.5f,
+             0.5f,  0.5f, -0.5f,   0.5f, -0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,
+
+            -0.5f,  0.5f, -0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,
+            -0.5f, -0.5f,  0.5f,  -0.5f, -0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+
+             0.5f,  0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, -0.5f,  0.5f,
+             0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,   0.5f,  0.5f, -0.5f,
+
+            -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, -0.5f,  0.5f,
+             0.5f, -0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,  -0.5f, -0.5f, -0.5f,
+
+            -0.5f,  0.5f, -0.5f,  -0.5f,  0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,   0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+    };
+    glGenVertexArrays(1, &cubeVAO);
+    glGenBuffers(1, &cubeVBO);
+    glBindVertexArray(cubeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+// Gap kept between a swept sphere and the surface it stopped at.
+static const float CONTACT_SKIN = 0.01f;
+// Number of slide iterations per sweep.
+static const int MAX_SLIDES = 3;
+
+Environment::Environment() {
+    glm::vec3 floorColor = glm::vec3(0.3f, 0.8f, 0.3f);
+    glm::vec3 wallColor = glm::vec3(0.35f, 0.35f, 0.4f);
+    glm::vec3 obstacleColor = glm::vec3(0.6f, 0.45f, 0.3f);
+
+    // Floor: its top sits just below y = 0 so the origin axes stay visible.
+    addBox(glm::vec3(-21.0f, -1.0f, -21.0f), glm::vec3(21.0f, -0.01f, 21.0f), floorColor);
+
+    // Walls: inner faces at +/-ROOM_HALF_WIDTH, 1 unit thick.
+    const float w = ROOM_HALF_WIDTH, h = ROOM_HEIGHT;
+    addBox(glm::vec3(-w - 1.0f, 0.0f, -w - 1.0f), glm::vec3(w + 1.0f, h, -w), wallColor); // Back
+    addBox(glm::vec3(-w - 1.0f, 0.0f,  w), glm::vec3(w + 1.0f, h,  w + 1.0f), wallColor); // Front
+    addBox(glm::vec3(-w - 1.0f, 0.0f, -w), glm::vec3(-w, h, w), wallColor); // Left
+    addBox(glm::vec3( w, 0.0f, -w), glm::vec3( w + 1.0f, h, w), wallColor); // Right
+
+    // Obstacles.
+    addBox(glm::vec3(  7.0f, 0.0f, -7.0f), glm::vec3(  9.0f, 6.0f, -5.0f), obstacleColor); // Pillar
+    addBox(glm::vec3( -9.0f, 0.0f,  4.0f), glm::vec3( -6.0f, 2.0f,  7.0f), obstacleColor); // Crate
+    addBox(glm::vec3(-12.0f, 4.0f, -11.0f), glm::vec3(-2.0f, 5.0f, -9.0f), obstacleColor); // Beam
+    addBox(glm::vec3( 12.0f, 0.0f,  10.0f), glm::vec3( 16.0f, 3.0f, 14.0f), obstacleColor); // Block
+
+    build();
+}
+
+void Environment::addBox(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &color) {
+    boxes.push_back({min, max});
+    colors.push_back(color);
+}
+
+void Environment::clear() {
+    boxes.clear();
+    colors.clear();
+    build();
+}
+
+void Environment::build() {
+    bvh.build(boxes);
+}
+
+const Bvh &Environment::getBvh() const {
+    return bvh;
+}
+
+const std::vector<Aabb> &Environment::getBoxes() const {
+    return boxes;
+}
+
+glm::vec3 Environment::sweepSphere(const glm::vec3 &from, const glm::vec3 &to, float radius, bool &collided) const {
+    glm::vec3 position = from;
+    glm::vec3 target = to;
+    collided = false;
+
+    for (int i = 0; i < MAX_SLIDES; i++) {
+        glm::vec3 delta = target - position;
+        float distance = glm::length(delta);
+        if (distance < 1e-6f)
+            return position;
+        glm::vec3 dir = delta / distance;
+
+        RayHit hit;
+        if (!bvh.intersect(position, dir, distance, radius, hit))
+            return target;
+
+        // Stop just short of the surface, then slide the rest of the motion along it.
+        collided = true;
+        position += dir * std::max(hit.distance - CONTACT_SKIN, 0.0f);
+        glm::vec3 remaining = target - position;
+        target = position + remaining - hit.normal * glm::dot(remaining, hit.normal);
+    }
+    return position;
+}
+
+bool Environment::overlapsSphere(const glm::vec3 &centre, float radius) const {
+    for (const Aabb &box : boxes) {
+        glm::vec3 closest = glm::clamp(centre, box.min, box.max);
+        glm::vec3 offset = centre - closest;
+        if (glm::dot(offset, offset) < radius * radius)
+            return true;
+    }
+    return false;
+}
+
+void Environment::render(Shader* shader) const {
+    initCube();
+
+    shader->use();
+    glBindVertexArray(cubeVAO);
+    for (size_t i = 0; i < boxes.size(); i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, (boxes[i].min + boxes[i].max) * 0.5f);
+        model = glm::scale(model, boxes[i].max - boxes[i].min);
+        shader->setMat4("model", model);
+        shader->setVec3("objectColor", colors[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    glBindVertexArray(0);
+}
@@ -1,63 +1,125 @@
 #include "InputHandler.h"
 #include "Drone.h"
 #include "Camera.h"
+#include "Profiler.h"
 #include <iostream>
 
+#ifdef DRONE_PROFILING
+// Where the 'x' key writes the profile, and how many seconds it covers.
+static const char* PROFILE_EXPORT_PATH = "profile.json";
+static const double PROFILE_EXPORT_SECONDS = 5.0;
+#endif
+
 Scene* InputHandler::scene = nullptr;
+SceneRenderer* InputHandler::renderer = nullptr;
 
 void InputHandler::setScene(Scene* scenePtr) {
     scene = scenePtr;
 }
 
+void InputHandler::setRenderer(SceneRenderer* rendererPtr) {
+    renderer = rendererPtr;
+}
+
 void InputHandler::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if(action == GLFW_PRESS || action == GLFW_REPEAT) {
-        if(!scene) return;
-        Drone* drone = scene->getDrone();
+        if(!scene || !renderer) return;
 
         // Adjust propeller speed.
         if(key == GLFW_KEY_S) {
-            drone->decreasePropellerSpeed();
+            scene->post([](Scene &s) { s.getDrone()->decreasePropellerSpeed(); });
         }
         if(key == GLFW_KEY_F) {
-            drone->increasePropellerSpeed();
+            scene->post([](Scene &s) { s.getDrone()->increasePropellerSpeed(); });
         }
         // Trigger roll.
         if(key == GLFW_KEY_J) {
-            drone->roll();
+            scene->post([](Scene &s) { s.getDrone()->roll(); });
         }
         // Move forward/backward.
         if(key == GLFW_KEY_KP_ADD || key == GLFW_KEY_EQUAL) { // '+' key.
-            drone->moveForward();
+            scene->post([](Scene &s) { s.getDrone()->moveForward(); });
         }
         if(key == GLFW_KEY_KP_SUBTRACT || key == GLFW_KEY_MINUS) { // '-' key.
-            drone->moveBackward();
+            scene->post([](Scene &s) { s.getDrone()->moveBackward(); });
         }
         // Turn using arrow keys.
         if(key == GLFW_KEY_LEFT) {
-            drone->turnLeft();
+            scene->post([](Scene &s) { s.getDrone()->turnLeft(); });
         }
         if(key == GLFW_KEY_RIGHT) {
-            drone->turnRight();
+            scene->post([](Scene &s) { s.getDrone()->turnRight(); });
         }
         if(key == GLFW_KEY_UP) {
-            drone->turnUp();
+            scene->post([](Scene &s) { s.getDrone()->turnUp(); });
         }
         if(key == GLFW_KEY_DOWN) {
-            drone->turnDown();
+            scene->post([](Scene &s) { s.getDrone()->turnDown(); });
+        }
+        // Send the fleet on its demo missions.
+        if(key == GLFW_KEY_M && action == GLFW_PRESS) {
+            scene->post([](Scene &s) { s.startDemoMissions(); });
+        }
+        // Send the fleet on courier missions along planned routes.
+        if(key == GLFW_KEY_G && action == GLFW_PRESS) {
+            scene->post([](Scene &s) { s.startDemoRoutes(); });
+        }
+        // Send the fleet round its demo paths, or take it off them.
+        if(key == GLFW_KEY_T && action == GLFW_PRESS) {
+            scene->post([](Scene &s) {
+                if (s.hasTrajectories())
+                    s.stopTrajectories();
+                else
+                    s.startDemoTrajectories();
+            });
         }
         // Reset the drone.
         if(key == GLFW_KEY_D) {
-            drone->reset();
+            scene->post([](Scene &s) { s.resetDrone(0); });
+        }
+        // Pause, step through the recorded history, or rewind one second.
+        if(key == GLFW_KEY_P && action == GLFW_PRESS) {
+            scene->post([](Scene &s) { s.setPaused(!s.isPaused()); });
+        }
+        if(key == GLFW_KEY_LEFT_BRACKET) {
+            scene->post([](Scene &s) { if (s.isPaused()) s.stepBack(); });
+        }
+        if(key == GLFW_KEY_RIGHT_BRACKET) {
+            scene->post([](Scene &s) { if (s.isPaused()) s.stepForward(); });
+        }
+        if(key == GLFW_KEY_B) {
+            scene->post([](Scene &s) { s.rewind(1.0f); });
+        }
+        // Toggle the wind.
+        if(key == GLFW_KEY_W && action == GLFW_PRESS) {
+            scene->post([](Scene &s) { s.setWindEnabled(!s.isWindEnabled()); });
+        }
+        // Export the last few seconds of profiling zones as a Chrome trace.
+        if(key == GLFW_KEY_X && action == GLFW_PRESS) {
+#ifdef DRONE_PROFILING
+            long long zones = Profiler::exportChromeTrace(PROFILE_EXPORT_PATH, PROFILE_EXPORT_SECONDS);
+            if (zones < 0)
+                std::cerr << "Failed to write " << PROFILE_EXPORT_PATH << std::endl;
+            else
+                std::cout << "Profile: " << zones << " zones from the last " << PROFILE_EXPORT_SECONDS << " s written to "
+                          << PROFILE_EXPORT_PATH << ", " << Profiler::measureZoneOverhead() << " ns per zone" << std::endl;
+#else
+            std::cout << "Profiling is not built in; rebuild with make PROFILE=1" << std::endl;
+#endif
+        }
+        // Toggle cockpit sensor rendering for the whole fleet.
+        if(key == GLFW_KEY_C && action == GLFW_PRESS) {
+            renderer->setSensorMode(!renderer->getSensorMode());
         }
         // Switch cameras (1, 2, 3).
         if(key == GLFW_KEY_1) {
-            scene->setActiveCamera(0);
+            renderer->setActiveCamera(0);
         }
         if(key == GLFW_KEY_2) {
-            scene->setActiveCamera(1);
+            renderer->setActiveCamera(1);
         }
         if(key == GLFW_KEY_3) {
-            scene->setActiveCamera(2);
+            renderer->setActiveCamera(2);
         }
     }
 }
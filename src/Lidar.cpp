@@ -0,0 +1,92 @@
+#include "Lidar.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cmath>
+
+Lidar::Lidar(int channels, int beamsPerChannel, float verticalFov, float maxRange)
+    : maxRange(maxRange), raysCast(0), secondsSpent(0.0)
+{
+    // Round the ray count up to whole packets; padding rays repeat the last beam.
+    int rays = channels * beamsPerChannel;
+    packetsPerDrone = (rays + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+    raysPerDrone = packetsPerDrone * RAY_PACKET_SIZE;
+
+    localX.resize(raysPerDrone);
+    localY.resize(raysPerDrone);
+    localZ.resize(raysPerDrone);
+    for (int i = 0; i < raysPerDrone; i++) {
+        int ray = i < rays ? i : rays - 1;
+        int channel = ray / beamsPerChannel;
+        int beam = ray % beamsPerChannel;
+        float elevation = channels > 1 ? glm::radians(-verticalFov * 0.5f + verticalFov * channel / (channels - 1)) : 0.0f;
+        float azimuth = glm::radians(360.0f * beam / beamsPerChannel);
+        // Azimuth 0 points along the drone's front (-Z), like Drone::getFront.
+        localX[i] = -std::sin(azimuth) * std::cos(elevation);
+        localY[i] = std::sin(elevation);
+        localZ[i] = -std::cos(azimuth) * std::cos(elevation);
+    }
+}
+
+void Lidar::scan(const Bvh &world, const std::vector<Drone> &drones, ThreadPool &pool) {
+    auto start = std::chrono::steady_clock::now();
+    ranges.resize(drones.size() * raysPerDrone);
+
+    int packetCount = static_cast<int>(drones.size()) * packetsPerDrone;
+    pool.parallelFor(packetCount, [&](int begin, int end) {
+        RayPacket packet;
+        int currentDrone = -1;
+        glm::vec3 origin, right, up, back;
+        for (int p = begin; p < end; p++) {
+            int droneIndex = p / packetsPerDrone;
+            if (droneIndex != currentDrone) {
+                // Sensor frame follows the drone's yaw and pitch, as in Drone::renderBody.
+                const Drone &drone = drones[droneIndex];
+                glm::vec3 rotation = drone.getRotation();
+                glm::mat4 frame = glm::rotate(glm::mat4(1.0f), glm::radians(rotation.y), glm::vec3(0, 1, 0));
+                frame = glm::rotate(frame, glm::radians(rotation.x), glm::vec3(1, 0, 0));
+                right = glm::vec3(frame[0]);
+                up = glm::vec3(frame[1]);
+                back = glm::vec3(frame[2]);
+                origin = drone.getPosition();
+                currentDrone = droneIndex;
+            }
+
+            int first = (p - droneIndex * packetsPerDrone) * RAY_PACKET_SIZE;
+            for (int l = 0; l < RAY_PACKET_SIZE; l++) {
+                float x = localX[first + l], y = localY[first + l], z = localZ[first + l];
+                packet.originX[l] = origin.x;
+                packet.originY[l] = origin.y;
+                packet.originZ[l] = origin.z;
+                packet.dirX[l] = right.x * x + up.x * y + back.x * z;
+                packet.dirY[l] = right.y * x + up.y * y + back.y * z;
+                packet.dirZ[l] = right.z * x + up.z * y + back.z * z;
+                packet.tMax[l] = maxRange;
+            }
+            world.intersectPacket(packet);
+
+            float* out = &ranges[static_cast<size_t>(droneIndex) * raysPerDrone + first];
+            for (int l = 0; l < RAY_PACKET_SIZE; l++)
+                out[l] = packet.tMax[l];
+        }
+    });
+
+    raysCast += static_cast<long long>(drones.size()) * raysPerDrone;
+    secondsSpent += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const std::vector<float> &Lidar::getRanges() const {
+    return ranges;
+}
+
+int Lidar::getRaysPerDrone() const {
+    return raysPerDrone;
+}
+
+double Lidar::getRaysPerSecond() const {
+    return secondsSpent > 0.0 ? raysCast / secondsSpent : 0.0;
+}
+
+void Lidar::resetStats() {
+    raysCast = 0;
+    secondsSpent = 0.0;
+}
@@ -0,0 +1,372 @@
+#include "Mission.h"
+#include "Scene.h"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <new>
+
+// Frames are rounded up to multiples of FRAME_GRANULARITY; frames larger
+// than the biggest size class fall back to the general heap.
+static const std::size_t FRAME_GRANULARITY = 64;
+static const int FRAME_SIZE_CLASSES = 16;
+// Blocks carved out of the heap at once when a size class runs dry.
+static const int BLOCKS_PER_CHUNK = 64;
+
+// Height at which a landed drone rests: its collision sphere touches the floor.
+static const float LANDING_HEIGHT = 1.0f;
+
+static const float TWO_PI = 6.28318531f;
+
+// A routed drone has arrived once it is this close to its destination.
+static const float ROUTE_ARRIVAL_DISTANCE = 0.5f;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+// Free lists per size class. Chunks are never returned to the heap, so a
+// frame released on another thread simply joins that thread's pool.
+struct FramePool {
+    FreeBlock* freeLists[FRAME_SIZE_CLASSES] = {};
+};
+static thread_local FramePool framePool;
+
+void* MissionFramePool::allocate(std::size_t size) {
+    std::size_t sizeClass = (size + FRAME_GRANULARITY - 1) / FRAME_GRANULARITY - 1;
+    if (sizeClass >= static_cast<std::size_t>(FRAME_SIZE_CLASSES))
+        return ::operator new(size);
+
+    FreeBlock* &freeList = framePool.freeLists[sizeClass];
+    if (!freeList) {
+        std::size_t blockSize = (sizeClass + 1) * FRAME_GRANULARITY;
+        char* chunk = static_cast<char*>(::operator new(blockSize * BLOCKS_PER_CHUNK));
+        for (int i = BLOCKS_PER_CHUNK - 1; i >= 0; i--) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+            block->next = freeList;
+            freeList = block;
+        }
+    }
+    FreeBlock* block = freeList;
+    freeList = block->next;
+    return block;
+}
+
+void MissionFramePool::release(void* frame, std::size_t size) {
+    std::size_t sizeClass = (size + FRAME_GRANULARITY - 1) / FRAME_GRANULARITY - 1;
+    if (sizeClass >= static_cast<std::size_t>(FRAME_SIZE_CLASSES)) {
+        ::operator delete(frame);
+        return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(frame);
+    block->next = framePool.freeLists[sizeClass];
+    framePool.freeLists[sizeClass] = block;
+}
+
+void Mission::promise_type::unhandled_exception() {
+    std::cerr << "Mission for drone " << drone << " threw an exception" << std::endl;
+    std::terminate();
+}
+
+Mission::Mission(Handle handle) : handle(handle) {
+}
+
+Mission::Mission(Mission &&other) noexcept : handle(other.handle) {
+    other.handle = nullptr;
+}
+
+Mission &Mission::operator=(Mission &&other) noexcept {
+    if (this != &other) {
+        if (handle)
+            handle.destroy();
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+Mission::~Mission() {
+    // Only missions that were never started still own their frame.
+    if (handle)
+        handle.destroy();
+}
+
+MissionScheduler::MissionScheduler(Scene &scene) : scene(scene), currentTick(0), activeCount(0), resumeCount(0) {
+}
+
+MissionScheduler::~MissionScheduler() {
+    for (auto &slot : wheel) {
+        for (auto &timer : slot)
+            timer.handle.destroy();
+    }
+    for (auto &active : controls)
+        active.handle.destroy();
+    for (auto handle : ready)
+        handle.destroy();
+}
+
+void MissionScheduler::start(Mission mission, int drone) {
+    Mission::Handle handle = mission.handle;
+    mission.handle = nullptr;
+    handle.promise().scheduler = this;
+    handle.promise().drone = drone;
+
+    if (drone >= static_cast<int>(busyDrones.size()))
+        busyDrones.resize(drone + 1, 0);
+    busyDrones[drone] = 1;
+    activeCount++;
+    ready.push_back(handle);
+}
+
+void MissionScheduler::update(float deltaTime) {
+    currentTick++;
+
+    // Motions first: a mission whose motion finished this tick resumes this tick.
+    for (size_t i = 0; i < controls.size();) {
+        ActiveControl &active = controls[i];
+        if (stepController(active.controller, active.handle.promise().drone, deltaTime)) {
+            ready.push_back(active.handle);
+            active = controls.back();
+            controls.pop_back();
+        } else {
+            i++;
+        }
+    }
+
+    // Only the current slot of the wheel is looked at; timers belonging to a
+    // later revolution stay put.
+    std::vector<Timer> &slot = wheel[currentTick % WHEEL_SLOTS];
+    for (size_t i = 0; i < slot.size();) {
+        if (slot[i].dueTick <= currentTick) {
+            ready.push_back(slot[i].handle);
+            slot[i] = slot.back();
+            slot.pop_back();
+        } else {
+            i++;
+        }
+    }
+
+    // Resumed missions may schedule new waits, so work from a copy.
+    resuming.swap(ready);
+    for (auto handle : resuming)
+        resume(handle);
+    resuming.clear();
+}
+
+void MissionScheduler::resume(Mission::Handle handle) {
+    resumeCount++;
+    handle.resume();
+    if (handle.done()) {
+        busyDrones[handle.promise().drone] = 0;
+        activeCount--;
+        handle.destroy();
+    }
+}
+
+bool MissionScheduler::hasMission(int drone) const {
+    return drone < static_cast<int>(busyDrones.size()) && busyDrones[drone];
+}
+
+int MissionScheduler::getActiveCount() const {
+    return activeCount;
+}
+
+long long MissionScheduler::getResumeCount() const {
+    return resumeCount;
+}
+
+void MissionScheduler::resetStats() {
+    resumeCount = 0;
+}
+
+Drone &MissionScheduler::getDrone(int drone) {
+    return *scene.getDrone(drone);
+}
+
+void MissionScheduler::sleep(Mission::Handle handle, float seconds) {
+    long long ticks = std::max(1LL, static_cast<long long>(std::lround(seconds / Scene::TICK_SECONDS)));
+    long long dueTick = currentTick + ticks;
+    wheel[dueTick % WHEEL_SLOTS].push_back({handle, dueTick});
+}
+
+void MissionScheduler::control(Mission::Handle handle, const MotionController &motion) {
+    Drone &drone = getDrone(handle.promise().drone);
+    glm::vec3 position = drone.getPosition();
+    MotionController controller = motion;
+
+    // Resolve the parts of the motion that depend on where the drone is now.
+    switch (controller.kind) {
+    case MotionController::CLIMB:
+        controller.target = glm::vec3(position.x, controller.target.y, position.z);
+        break;
+    case MotionController::ORBIT: {
+        glm::vec3 offset = position - controller.target;
+        controller.radius = std::max(std::sqrt(offset.x * offset.x + offset.z * offset.z), 1.0f);
+        controller.angle = std::atan2(offset.z, offset.x);
+        controller.target.y = position.y;
+        break;
+    }
+    case MotionController::ROLL:
+        drone.roll();
+        break;
+    case MotionController::ROUTE:
+        scene.requestRoute(handle.promise().drone, controller.target, controller.speed);
+        break;
+    default:
+        break;
+    }
+
+    // Allow twice the nominal duration before giving up; routes go round
+    // obstacles, so they get more.
+    if (controller.kind == MotionController::ORBIT)
+        controller.timeLeft = 2.0f * controller.angleLeft * controller.radius / controller.speed + 1.0f;
+    else if (controller.kind == MotionController::ROUTE)
+        controller.timeLeft = 4.0f * glm::length(controller.target - position) / controller.speed + 5.0f;
+    else if (controller.kind != MotionController::ROLL)
+        controller.timeLeft = 2.0f * glm::length(controller.target - position) / controller.speed + 1.0f;
+    controls.push_back({handle, controller});
+}
+
+bool MissionScheduler::stepController(MotionController &controller, int index, float deltaTime) {
+    Drone &drone = getDrone(index);
+    controller.timeLeft -= deltaTime;
+    glm::vec3 position = drone.getPosition();
+    glm::vec3 rotation = drone.getRotation();
+
+    switch (controller.kind) {
+    case MotionController::FLY_TO:
+    case MotionController::CLIMB: {
+        glm::vec3 toTarget = controller.target - position;
+        float distance = glm::length(toTarget);
+        float stepLength = controller.speed * deltaTime;
+        if (distance <= stepLength || controller.timeLeft <= 0.0f) {
+            if (distance <= stepLength)
+                drone.setPosition(controller.target);
+            // Level off on arrival.
+            drone.setRotation(glm::vec3(0.0f, rotation.y, rotation.z));
+            return true;
+        }
+        glm::vec3 dir = toTarget / distance;
+        drone.setPosition(position + dir * stepLength);
+        if (controller.kind == MotionController::FLY_TO) {
+            // Inverse of Drone::getFront().
+            float pitch = glm::degrees(std::asin(dir.y));
+            float yaw = glm::degrees(std::atan2(-dir.x, -dir.z));
+            drone.setRotation(glm::vec3(pitch, yaw, rotation.z));
+        }
+        return false;
+    }
+    case MotionController::ORBIT: {
+        float step = std::min(controller.speed / controller.radius * deltaTime, controller.angleLeft);
+        controller.angle += step;
+        controller.angleLeft -= step;
+        float c = std::cos(controller.angle), s = std::sin(controller.angle);
+        drone.setPosition(controller.target + glm::vec3(c, 0.0f, s) * controller.radius);
+        // Face along the circle.
+        drone.setRotation(glm::vec3(0.0f, glm::degrees(std::atan2(s, -c)), rotation.z));
+        return controller.angleLeft <= 0.0f || controller.timeLeft <= 0.0f;
+    }
+    case MotionController::ROLL:
+        return !drone.isPerformingRoll();
+    case MotionController::ROUTE:
+        // The scene moves the drone along its route.
+        if (glm::length(controller.target - position) < ROUTE_ARRIVAL_DISTANCE || scene.isRouteFailed(index) ||
+            !scene.getRoutes().hasRoute(index) || controller.timeLeft <= 0.0f) {
+            scene.cancelRoute(index);
+            return true;
+        }
+        return false;
+    }
+    return true;
+}
+
+MissionSleep waitFor(float seconds) {
+    return {seconds};
+}
+
+MissionMotion takeOff(float height, float speed) {
+    MotionController controller = {};
+    controller.kind = MotionController::CLIMB;
+    controller.target = glm::vec3(0.0f, height, 0.0f);
+    controller.speed = speed;
+    return {controller};
+}
+
+MissionMotion flyTo(const glm::vec3 &target, float speed) {
+    MotionController controller = {};
+    controller.kind = MotionController::FLY_TO;
+    controller.target = target;
+    controller.speed = speed;
+    return {controller};
+}
+
+MissionMotion orbit(const glm::vec3 &center, float turns, float speed) {
+    MotionController controller = {};
+    controller.kind = MotionController::ORBIT;
+    controller.target = center;
+    controller.speed = speed;
+    controller.angleLeft = turns * TWO_PI;
+    return {controller};
+}
+
+MissionMotion rollManeuver() {
+    MotionController controller = {};
+    controller.kind = MotionController::ROLL;
+    return {controller};
+}
+
+MissionMotion land(float speed) {
+    MotionController controller = {};
+    controller.kind = MotionController::CLIMB;
+    controller.target = glm::vec3(0.0f, LANDING_HEIGHT, 0.0f);
+    controller.speed = speed;
+    return {controller};
+}
+
+MissionMotion flyRoute(const glm::vec3 &target, float speed) {
+    MotionController controller = {};
+    controller.kind = MotionController::ROUTE;
+    controller.target = target;
+    controller.speed = speed;
+    return {controller};
+}
+
+Mission patrolMission(glm::vec3 home, float delay) {
+    // Stagger the fleet so the drones do not all move in lockstep.
+    co_await waitFor(delay);
+
+    float height = home.y + 3.0f;
+    float size = 2.5f;
+    co_await takeOff(height);
+    co_await flyTo(home + glm::vec3( size, 3.0f,  size));
+    co_await flyTo(home + glm::vec3( size, 3.0f, -size));
+    co_await flyTo(home + glm::vec3(-size, 3.0f, -size));
+    co_await flyTo(home + glm::vec3(-size, 3.0f,  size));
+    co_await orbit(glm::vec3(home.x, height, home.z), 1.0f);
+    co_await rollManeuver();
+    co_await flyTo(glm::vec3(home.x, height, home.z));
+    co_await land();
+    co_await waitFor(1.0f);
+    co_await takeOff(home.y);
+}
+
+Mission courierMission(glm::vec3 home, uint32_t seed) {
+    // Small xorshift generator, so every drone picks its own points.
+    uint32_t state = seed * 0x9e3779b1u + 1;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state & 0xffff) / 65535.0f;
+    };
+
+    float height = home.y + 2.0f;
+    co_await takeOff(height);
+    for (int leg = 0; leg < 4; leg++) {
+        glm::vec3 target(-17.0f + 34.0f * next(), 2.0f + 6.0f * next(), -17.0f + 34.0f * next());
+        co_await flyRoute(target);
+        co_await waitFor(0.5f);
+    }
+    co_await flyRoute(glm::vec3(home.x, height, home.z));
+    co_await land();
+}
@@ -0,0 +1,493 @@
+#include "PathPlanner.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// The volume planned over: the room inside the walls, up to their top.
+static const glm::vec3 PLAN_MIN(-20.0f, 0.0f, -20.0f);
+static const glm::vec3 PLAN_MAX(20.0f, 10.0f, 20.0f);
+static const float PLAN_CELL_SIZE = 1.0f;
+
+// A search gives up after expanding this many times the number of cells.
+static const int MAX_EXPANSIONS_PER_CELL = 8;
+
+// Line-of-sight checks along a route sample it at this fraction of a cell.
+static const float SIGHT_STEP = 0.25f;
+
+static const float INFINITE_COST = std::numeric_limits<float>::infinity();
+
+// Keys this close count as equal when deciding whether the start is
+// settled, so a cell tied with the start is never left inconsistent by
+// rounding and then routed through.
+static const float KEY_TOLERANCE = 1e-4f;
+
+bool DStarLite::QueueEntry::operator<(const QueueEntry &other) const {
+    return key1 > other.key1 || (key1 == other.key1 && key2 > other.key2);
+}
+
+DStarLite::DStarLite()
+    : cells(nullptr), sizeX(0), sizeY(0), sizeZ(0), start(-1), goal(-1), lastStart(-1), keyModifier(0.0f),
+      expansions(0) {
+    int i = 0;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx != 0 || dy != 0 || dz != 0)
+                    neighbours[i++] = {dx, dy, dz, 0, 0.0f, {0, 0, 0}, 0};
+            }
+        }
+    }
+}
+
+void DStarLite::setGrid(const std::shared_ptr<const VoxelGrid> &newGrid) {
+    bool sameShape = grid && grid->getSizeX() == newGrid->getSizeX() && grid->getSizeY() == newGrid->getSizeY() &&
+                     grid->getSizeZ() == newGrid->getSizeZ() && grid->getCellSize() == newGrid->getCellSize();
+    grid = newGrid;
+    cells = grid->getCells();
+    if (sameShape)
+        return;
+    sizeX = grid->getSizeX();
+    sizeY = grid->getSizeY();
+    sizeZ = grid->getSizeZ();
+    int strideZ = sizeX, strideY = sizeX * sizeZ;
+    for (auto &neighbour : neighbours) {
+        neighbour.offset = neighbour.dx + neighbour.dz * strideZ + neighbour.dy * strideY;
+        int axes = (neighbour.dx != 0) + (neighbour.dy != 0) + (neighbour.dz != 0);
+        neighbour.length = std::sqrt(static_cast<float>(axes)) * grid->getCellSize();
+        neighbour.sideCount = 0;
+        if (axes > 1) {
+            if (neighbour.dx != 0)
+                neighbour.sides[neighbour.sideCount++] = neighbour.dx;
+            if (neighbour.dz != 0)
+                neighbour.sides[neighbour.sideCount++] = neighbour.dz * strideZ;
+            if (neighbour.dy != 0)
+                neighbour.sides[neighbour.sideCount++] = neighbour.dy * strideY;
+        }
+    }
+}
+
+void DStarLite::reset(int cellCount) {
+    g.assign(cellCount, INFINITE_COST);
+    rhs.assign(cellCount, INFINITE_COST);
+    stamps.assign(cellCount, 0);
+    queued.assign(cellCount, 0);
+    queue.clear();
+    keyModifier = 0.0f;
+}
+
+bool DStarLite::isBlocked(int cell) const {
+    return cells[cell] != VoxelGrid::FREE && cell != start && cell != goal;
+}
+
+bool DStarLite::canMove(int from, const Neighbour &neighbour) const {
+    if (isBlocked(from + neighbour.offset))
+        return false;
+    for (int i = 0; i < neighbour.sideCount; i++) {
+        if (isBlocked(from + neighbour.sides[i]))
+            return false;
+    }
+    return true;
+}
+
+// Calls fn(neighbourCell, neighbour) for every neighbour inside the grid.
+template <typename Fn>
+void DStarLite::forEachNeighbour(int cell, Fn fn) const {
+    int x = cell % sizeX;
+    int rest = cell / sizeX;
+    int z = rest % sizeZ;
+    int y = rest / sizeZ;
+    bool inside = x > 0 && x < sizeX - 1 && y > 0 && y < sizeY - 1 && z > 0 && z < sizeZ - 1;
+    for (auto &neighbour : neighbours) {
+        if (!inside) {
+            int nx = x + neighbour.dx, ny = y + neighbour.dy, nz = z + neighbour.dz;
+            if (nx < 0 || ny < 0 || nz < 0 || nx >= sizeX || ny >= sizeY || nz >= sizeZ)
+                continue;
+        }
+        fn(cell + neighbour.offset, neighbour);
+    }
+}
+
+float DStarLite::heuristic(int a, int b) const {
+    int ax = a % sizeX, az = (a / sizeX) % sizeZ, ay = a / sizeX / sizeZ;
+    int bx = b % sizeX, bz = (b / sizeX) % sizeZ, by = b / sizeX / sizeZ;
+    glm::vec3 d(static_cast<float>(ax - bx), static_cast<float>(ay - by), static_cast<float>(az - bz));
+    return glm::length(d) * grid->getCellSize();
+}
+
+void DStarLite::calculateKey(int cell, float &key1, float &key2) const {
+    key2 = std::min(g[cell], rhs[cell]);
+    key1 = key2 + heuristic(start, cell) + keyModifier;
+}
+
+void DStarLite::push(int cell) {
+    QueueEntry entry;
+    calculateKey(cell, entry.key1, entry.key2);
+    entry.cell = cell;
+    entry.stamp = ++stamps[cell];
+    queued[cell] = 1;
+    queue.push_back(entry);
+    std::push_heap(queue.begin(), queue.end());
+}
+
+void DStarLite::updateVertex(int cell) {
+    if (cell != goal) {
+        float best = INFINITE_COST;
+        if (!isBlocked(cell)) {
+            forEachNeighbour(cell, [&](int next, const Neighbour &neighbour) {
+                // Only check the move when it would improve on the best so far.
+                float total = g[next] + neighbour.length;
+                if (total < best && canMove(cell, neighbour))
+                    best = total;
+            });
+        }
+        rhs[cell] = best;
+    }
+    // Any queued entry becomes stale; requeue only if the cell is inconsistent.
+    queued[cell] = 0;
+    if (g[cell] != rhs[cell])
+        push(cell);
+}
+
+// The costs of every edge touching a cell, or cutting past it diagonally,
+// change with its occupancy; all such edges start within its neighbourhood.
+void DStarLite::updateAround(int cell) {
+    updateVertex(cell);
+    forEachNeighbour(cell, [&](int next, const Neighbour &) { updateVertex(next); });
+}
+
+bool DStarLite::computeShortestPath() {
+    long long limit = static_cast<long long>(grid->getCellCount()) * MAX_EXPANSIONS_PER_CELL;
+    for (;;) {
+        // Drop stale entries.
+        while (!queue.empty() && (!queued[queue.front().cell] || queue.front().stamp != stamps[queue.front().cell])) {
+            std::pop_heap(queue.begin(), queue.end());
+            queue.pop_back();
+        }
+        if (queue.empty())
+            return true;
+        float start1, start2;
+        calculateKey(start, start1, start2);
+        if (queue.front().key1 > start1 + KEY_TOLERANCE && rhs[start] == g[start])
+            return true;
+        if (++expansions > limit)
+            return false;
+
+        QueueEntry entry = queue.front();
+        std::pop_heap(queue.begin(), queue.end());
+        queue.pop_back();
+        int cell = entry.cell;
+        queued[cell] = 0;
+
+        float key1, key2;
+        calculateKey(cell, key1, key2);
+        if (entry.key1 < key1 || (entry.key1 == key1 && entry.key2 < key2)) {
+            // Its key grew since it was queued (the start moved); try again later.
+            push(cell);
+        } else if (g[cell] > rhs[cell]) {
+            g[cell] = rhs[cell];
+            // Its cost only fell, so a neighbour's rhs can only fall to the
+            // cost through it; no need to look at all of theirs.
+            forEachNeighbour(cell, [&](int previous, const Neighbour &neighbour) {
+                const Neighbour &back = neighbours[NEIGHBOURS - 1 - (&neighbour - neighbours)];
+                float total = g[cell] + back.length;
+                if (previous != goal && total < rhs[previous] && !isBlocked(previous) && canMove(previous, back)) {
+                    rhs[previous] = total;
+                    queued[previous] = 0;
+                    if (g[previous] != rhs[previous])
+                        push(previous);
+                }
+            });
+        } else {
+            g[cell] = INFINITE_COST;
+            updateAround(cell);
+        }
+    }
+}
+
+bool DStarLite::plan(const std::shared_ptr<const VoxelGrid> &newGrid, int newStart, int newGoal, std::vector<int> &path) {
+    expansions = 0;
+    path.clear();
+
+    bool fresh = !grid || grid->getCellCount() != newGrid->getCellCount() || newGoal != goal;
+    if (fresh) {
+        setGrid(newGrid);
+        start = newStart;
+        lastStart = newStart;
+        goal = newGoal;
+        reset(grid->getCellCount());
+        rhs[goal] = 0.0f;
+        push(goal);
+    } else {
+        // Cells whose occupancy changed, plus the old and new start, which
+        // is always free while the drone is in it.
+        changed.clear();
+        if (newGrid != grid)
+            grid->diff(*newGrid, changed);
+        if (newStart != start) {
+            changed.push_back(start);
+            changed.push_back(newStart);
+        }
+        setGrid(newGrid);
+        start = newStart;
+        keyModifier += heuristic(lastStart, start);
+        lastStart = start;
+        for (int cell : changed) {
+            // Every edge whose cost the cell affects ends in its
+            // neighbourhood; if the search never reached there, no rhs changes.
+            bool reached = g[cell] != INFINITE_COST;
+            forEachNeighbour(cell, [&](int next, const Neighbour &) { reached = reached || g[next] != INFINITE_COST; });
+            if (reached)
+                updateAround(cell);
+        }
+    }
+
+    if (!computeShortestPath() || g[start] == INFINITE_COST)
+        return false;
+
+    // Walk downhill from the start.
+    int cell = start;
+    path.push_back(cell);
+    for (int steps = 0; cell != goal && steps < grid->getCellCount(); steps++) {
+        int best = -1;
+        float bestCost = INFINITE_COST;
+        forEachNeighbour(cell, [&](int next, const Neighbour &neighbour) {
+            float total = g[next] + neighbour.length;
+            if (total < bestCost && canMove(cell, neighbour)) {
+                bestCost = total;
+                best = next;
+            }
+        });
+        if (best < 0)
+            return false;
+        cell = best;
+        path.push_back(cell);
+    }
+    return cell == goal;
+}
+
+long long DStarLite::getExpansions() const {
+    return expansions;
+}
+
+// Whether the straight line between two points only crosses free cells,
+// counting the cells holding `from` and `to` as free.
+static bool hasLineOfSight(const VoxelGrid &grid, const glm::vec3 &from, const glm::vec3 &to) {
+    int first = grid.cellAt(from), last = grid.cellAt(to);
+    float distance = glm::length(to - from);
+    int steps = static_cast<int>(distance / (grid.getCellSize() * SIGHT_STEP)) + 1;
+    for (int i = 1; i < steps; i++) {
+        int cell = grid.cellAt(from + (to - from) * (static_cast<float>(i) / steps));
+        if (cell != first && cell != last && grid.get(cell) != VoxelGrid::FREE)
+            return false;
+    }
+    return true;
+}
+
+// Waypoints from the drone to its goal through the cells of a path, keeping
+// only the cells needed to stay in sight of the previous waypoint.
+static void simplifyRoute(const VoxelGrid &grid, const std::vector<int> &cells, const glm::vec3 &from,
+                          const glm::vec3 &to, std::vector<glm::vec3> &waypoints) {
+    std::vector<glm::vec3> points;
+    points.push_back(from);
+    for (size_t i = 1; i + 1 < cells.size(); i++)
+        points.push_back(grid.cellCentre(cells[i]));
+    points.push_back(to);
+
+    waypoints.clear();
+    waypoints.push_back(from);
+    size_t anchor = 0;
+    while (anchor + 1 < points.size()) {
+        size_t next = anchor + 1;
+        while (next + 1 < points.size() && hasLineOfSight(grid, points[anchor], points[next + 1]))
+            next++;
+        waypoints.push_back(points[next]);
+        anchor = next;
+    }
+}
+
+RoutePlanner::RoutePlanner(const Environment &environment, float droneRadius)
+    : obstacles(PLAN_MIN, PLAN_MAX, PLAN_CELL_SIZE), gridTick(0), activeCount(0), jobsInFlight(0) {
+    obstacles.addObstacles(environment.getBoxes(), droneRadius);
+    resetStats();
+}
+
+RoutePlanner::~RoutePlanner() {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsDone.wait(lock, [this] { return jobsInFlight == 0; });
+}
+
+void RoutePlanner::request(int drone, const glm::vec3 &goal) {
+    if (drone >= static_cast<int>(routes.size()))
+        routes.resize(drone + 1);
+    Route &route = routes[drone];
+    if (!route.active) {
+        route.active = true;
+        activeCount++;
+    }
+    if (!route.search)
+        route.search = std::make_unique<DStarLite>();
+    route.goal = goal;
+    route.goalChanged = true;
+    route.failed = false;
+}
+
+void RoutePlanner::cancel(int drone) {
+    if (!hasRoute(drone))
+        return;
+    routes[drone].active = false;
+    activeCount--;
+}
+
+void RoutePlanner::cancelAll() {
+    for (int i = 0; i < static_cast<int>(routes.size()); i++)
+        cancel(i);
+}
+
+bool RoutePlanner::hasRoute(int drone) const {
+    return drone < static_cast<int>(routes.size()) && routes[drone].active;
+}
+
+bool RoutePlanner::hasFailed(int drone) const {
+    return hasRoute(drone) && routes[drone].failed;
+}
+
+int RoutePlanner::getActiveCount() const {
+    return activeCount;
+}
+
+void RoutePlanner::update(const std::vector<Drone> &drones, long long tick) {
+    if (activeCount == 0)
+        return;
+
+    if (!grid || tick - gridTick >= GRID_INTERVAL_TICKS) {
+        auto next = std::make_shared<VoxelGrid>(obstacles);
+        dronePositions.clear();
+        for (auto &drone : drones)
+            dronePositions.push_back(drone.getPosition());
+        next->addDrones(dronePositions);
+        next->setVersion(grid ? grid->getVersion() + 1 : 1);
+        grid = next;
+        gridTick = tick;
+    }
+
+    int count = std::min(static_cast<int>(routes.size()), static_cast<int>(drones.size()));
+    for (int i = 0; i < count; i++) {
+        Route &route = routes[i];
+        if (route.active && !route.busy && (route.goalChanged || route.plannedVersion < grid->getVersion()))
+            startPlan(i, drones[i].getPosition());
+    }
+}
+
+void RoutePlanner::startPlan(int drone, const glm::vec3 &position) {
+    Route &route = routes[drone];
+    bool replan = !route.goalChanged;
+    route.busy = true;
+    route.goalChanged = false;
+    route.plannedVersion = grid->getVersion();
+
+    std::shared_ptr<const VoxelGrid> snapshot = grid;
+    DStarLite* search = route.search.get();
+    glm::vec3 goal = route.goal;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobsInFlight++;
+    }
+    planners.submit([this, snapshot, search, drone, position, goal, replan]() {
+        auto begin = std::chrono::steady_clock::now();
+        RoutePlan plan;
+        plan.drone = drone;
+        plan.replan = replan;
+        std::vector<int> cells;
+        plan.found = search->plan(snapshot, snapshot->cellAt(position), snapshot->cellAt(goal), cells);
+        plan.expansions = search->getExpansions();
+        if (plan.found)
+            simplifyRoute(*snapshot, cells, position, goal, plan.waypoints);
+        plan.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(plan));
+        jobsInFlight--;
+        jobsDone.notify_all();
+    });
+}
+
+void RoutePlanner::collectResults(std::vector<RoutePlan> &results) {
+    results.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.swap(finished);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        RoutePlan &plan = results[i];
+        Route &route = routes[plan.drone];
+        route.busy = false;
+        if (plan.replan) {
+            replanCount++;
+            replanSeconds += plan.seconds;
+            replanExpansions += plan.expansions;
+        } else {
+            planCount++;
+            planSeconds += plan.seconds;
+            planExpansions += plan.expansions;
+        }
+        // Drop plans for cancelled routes and for goals that have since changed.
+        if (!route.active || route.goalChanged)
+            continue;
+        route.failed = !plan.found;
+        if (kept != i)
+            results[kept] = std::move(plan);
+        kept++;
+    }
+    results.resize(kept);
+}
+
+std::shared_ptr<const VoxelGrid> RoutePlanner::getGrid() const {
+    return grid;
+}
+
+double RoutePlanner::getPlansPerSecond() const {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+    return (planCount + replanCount) / std::max(elapsed, 1e-9);
+}
+
+long long RoutePlanner::getPlanCount() const {
+    return planCount;
+}
+
+long long RoutePlanner::getReplanCount() const {
+    return replanCount;
+}
+
+double RoutePlanner::getAveragePlanMicros() const {
+    return planCount > 0 ? planSeconds * 1e6 / planCount : 0.0;
+}
+
+double RoutePlanner::getAverageReplanMicros() const {
+    return replanCount > 0 ? replanSeconds * 1e6 / replanCount : 0.0;
+}
+
+double RoutePlanner::getAveragePlanExpansions() const {
+    return planCount > 0 ? static_cast<double>(planExpansions) / planCount : 0.0;
+}
+
+double RoutePlanner::getAverageReplanExpansions() const {
+    return replanCount > 0 ? static_cast<double>(replanExpansions) / replanCount : 0.0;
+}
+
+void RoutePlanner::resetStats() {
+    statsStart = std::chrono::steady_clock::now();
+    planCount = replanCount = 0;
+    planSeconds = replanSeconds = 0.0;
+    planExpansions = replanExpansions = 0;
+}
+
+std::size_t RoutePlanner::getMemoryUsage() const {
+    // Each search keeps g, rhs, a stamp and a queued flag per cell, plus its heap.
+    std::size_t perSearch = static_cast<std::size_t>(obstacles.getCellCount()) * (2 * sizeof(float) + sizeof(uint32_t) + 1);
+    std::size_t searches = 0;
+    for (auto &route : routes)
+        searches += route.search ? 1 : 0;
+    return searches * perSearch + 2 * static_cast<std::size_t>(obstacles.getCellCount());
+}
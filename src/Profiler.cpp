@@ -0,0 +1,175 @@
+#include "Profiler.h"
+
+#ifdef DRONE_PROFILING
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Zones timed by measureZoneOverhead().
+static const int OVERHEAD_SAMPLES = 1 << 20;
+
+namespace {
+
+struct Zone {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> begin;
+    std::atomic<uint64_t> end;
+};
+
+// A ring of zones written by one thread and read by exportChromeTrace. The
+// writer publishes each zone by bumping `count`; a reader copies the ring and
+// then rereads `count` to tell which slots may have been overwritten meanwhile.
+struct ThreadBuffer {
+    std::string name;
+    int id = 0;
+    std::unique_ptr<Zone[]> zones{new Zone[Profiler::ZONES_PER_THREAD]};
+    std::atomic<uint64_t> count{0}; // Zones ever recorded.
+};
+
+struct ClockSample {
+    uint64_t ticks;
+    std::chrono::steady_clock::time_point time;
+};
+
+ClockSample sampleClock() {
+    return {Profiler::now(), std::chrono::steady_clock::now()};
+}
+
+// Every thread that ever recorded a zone. Buffers outlive their threads so
+// a pool that has shut down can still be exported.
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+// Taken at start-up; timestamps are exported relative to it, and the TSC
+// rate is calibrated against steady_clock over the time since.
+const ClockSample epoch = sampleClock();
+
+thread_local ThreadBuffer* currentBuffer = nullptr;
+
+ThreadBuffer* registerThread() {
+    auto buffer = std::make_unique<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->id = static_cast<int>(registry.size()) + 1;
+    buffer->name = "thread " + std::to_string(buffer->id);
+    registry.push_back(std::move(buffer));
+    return registry.back().get();
+}
+
+double ticksPerMicrosecond() {
+    // Calibrate over at least a few milliseconds.
+    if (std::chrono::steady_clock::now() - epoch.time < std::chrono::milliseconds(10))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ClockSample sample = sampleClock();
+    double micros = std::chrono::duration<double, std::micro>(sample.time - epoch.time).count();
+    return static_cast<double>(sample.ticks - epoch.ticks) / micros;
+}
+
+void writeJsonString(std::ostream &out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void Profiler::setThreadName(const char* name) {
+    if (!currentBuffer)
+        currentBuffer = registerThread();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    currentBuffer->name = name;
+}
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end) {
+    ThreadBuffer* buffer = currentBuffer;
+    if (!buffer)
+        buffer = currentBuffer = registerThread();
+    uint64_t index = buffer->count.load(std::memory_order_relaxed);
+    // Keeps the previous count ahead of the stores below for a reader.
+    std::atomic_thread_fence(std::memory_order_release);
+    Zone &zone = buffer->zones[index & (ZONES_PER_THREAD - 1)];
+    zone.name.store(name, std::memory_order_relaxed);
+    zone.begin.store(begin, std::memory_order_relaxed);
+    zone.end.store(end, std::memory_order_relaxed);
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+long long Profiler::exportChromeTrace(const std::string &path, double seconds) {
+    std::ofstream out(path);
+    if (!out)
+        return -1;
+
+    double rate = ticksPerMicrosecond();
+    uint64_t latest = now();
+    uint64_t window = static_cast<uint64_t>(seconds * 1e6 * rate);
+    uint64_t cutoff = latest > window ? latest - window : 0;
+
+    struct Copy {
+        const char* name;
+        uint64_t begin, end;
+    };
+    std::vector<Copy> copies;
+    long long written = 0;
+    bool first = true;
+    out << "{\"traceEvents\":[";
+    out.setf(std::ios::fixed);
+    out.precision(3);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto &buffer : registry) {
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t oldest = count > ZONES_PER_THREAD ? count - ZONES_PER_THREAD : 0;
+        copies.clear();
+        for (uint64_t i = oldest; i < count; i++) {
+            Zone &zone = buffer->zones[i & (ZONES_PER_THREAD - 1)];
+            copies.push_back({zone.name.load(std::memory_order_relaxed), zone.begin.load(std::memory_order_relaxed),
+                              zone.end.load(std::memory_order_relaxed)});
+        }
+        // The owner may have kept recording; drop any slot it could have reached.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = buffer->count.load(std::memory_order_relaxed);
+        uint64_t valid = after + 1 > ZONES_PER_THREAD ? after + 1 - ZONES_PER_THREAD : 0;
+        std::size_t skip = static_cast<std::size_t>(std::min(count, std::max(oldest, valid)) - oldest);
+
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, buffer->name.c_str());
+        out << "}}";
+        first = false;
+        for (std::size_t i = skip; i < copies.size(); i++) {
+            const Copy &zone = copies[i];
+            if (zone.end < cutoff || zone.begin < epoch.ticks)
+                continue;
+            out << ",\n{\"name\":";
+            writeJsonString(out, zone.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << (zone.begin - epoch.ticks) / rate
+                << ",\"dur\":" << (zone.end - zone.begin) / rate << "}";
+            written++;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out ? written : -1;
+}
+
+double Profiler::measureZoneOverhead() {
+    ThreadBuffer scratch;
+    ThreadBuffer* saved = currentBuffer;
+    currentBuffer = &scratch;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < OVERHEAD_SAMPLES; i++) {
+        PROFILE_ZONE("overhead");
+    }
+    auto end = std::chrono::steady_clock::now();
+    currentBuffer = saved;
+    return std::chrono::duration<double, std::nano>(end - begin).count() / OVERHEAD_SAMPLES;
+}
+
+#endif // DRONE_PROFILING
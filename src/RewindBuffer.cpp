@@ -0,0 +1,167 @@
+#include "RewindBuffer.h"
+#include <algorithm>
+
+// Unchanged bytes tolerated inside a changed run before it is split in two.
+// Shorter gaps cost more as run headers than as literal bytes.
+static const std::size_t MAX_LITERAL_GAP = 4;
+
+static void writeVarint(std::vector<unsigned char> &out, std::size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+static std::size_t readVarint(const unsigned char* &in) {
+    std::size_t value = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        value |= static_cast<std::size_t>(*in++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<std::size_t>(*in++) << shift;
+    return value;
+}
+
+RewindBuffer::RewindBuffer(int keyframeInterval, std::size_t memoryBudget)
+    : keyframeInterval(std::max(keyframeInterval, 1)), memoryBudget(memoryBudget), memoryUsage(0)
+{
+}
+
+std::size_t RewindBuffer::segmentBytes(const Segment &segment) {
+    return segment.keyframe.size() + segment.deltas.size() + segment.deltaEnds.size() * sizeof(std::size_t);
+}
+
+void RewindBuffer::encodeDelta(const std::vector<unsigned char> &from, const std::vector<unsigned char> &to,
+                               std::vector<unsigned char> &out) {
+    // Runs of [unchanged byte count][changed byte count][changed bytes XOR previous].
+    std::size_t n = to.size();
+    std::size_t i = 0;
+    while (i < n) {
+        std::size_t runStart = i;
+        while (i < n && from[i] == to[i])
+            i++;
+        if (i == n)
+            break;
+
+        std::size_t literalStart = i;
+        std::size_t lastChanged = i;
+        for (std::size_t j = i + 1; j < n && j - lastChanged <= MAX_LITERAL_GAP; j++) {
+            if (from[j] != to[j])
+                lastChanged = j;
+        }
+
+        writeVarint(out, literalStart - runStart);
+        writeVarint(out, lastChanged + 1 - literalStart);
+        for (std::size_t j = literalStart; j <= lastChanged; j++)
+            out.push_back(from[j] ^ to[j]);
+        i = lastChanged + 1;
+    }
+}
+
+void RewindBuffer::applyDelta(const unsigned char* delta, const unsigned char* end, std::vector<unsigned char> &state) {
+    std::size_t position = 0;
+    while (delta < end) {
+        position += readVarint(delta);
+        std::size_t count = readVarint(delta);
+        unsigned char* out = &state[position];
+        for (std::size_t j = 0; j < count; j++)
+            out[j] ^= delta[j];
+        delta += count;
+        position += count;
+    }
+}
+
+void RewindBuffer::record(long long tick, const std::vector<unsigned char> &snapshot) {
+    bool continues = !segments.empty() && tick == getNewestTick() + 1 && snapshot.size() == newest.size();
+    if (!continues)
+        clear();
+
+    if (segments.empty() || static_cast<int>(segments.back().deltaEnds.size()) + 1 >= keyframeInterval) {
+        Segment segment;
+        segment.firstTick = tick;
+        segment.keyframe = snapshot;
+        segment.deltaEnds.reserve(keyframeInterval);
+        memoryUsage += segmentBytes(segment);
+        segments.push_back(std::move(segment));
+    } else {
+        Segment &segment = segments.back();
+        memoryUsage -= segmentBytes(segment);
+        encodeDelta(newest, snapshot, segment.deltas);
+        segment.deltaEnds.push_back(segment.deltas.size());
+        memoryUsage += segmentBytes(segment);
+    }
+    newest = snapshot;
+
+    // Always keep the segment being written, even if it alone exceeds the budget.
+    while (memoryUsage > memoryBudget && segments.size() > 1) {
+        memoryUsage -= segmentBytes(segments.front());
+        segments.pop_front();
+    }
+}
+
+bool RewindBuffer::seek(long long tick, std::vector<unsigned char> &snapshot) const {
+    if (segments.empty() || tick < getOldestTick() || tick > getNewestTick())
+        return false;
+
+    // Segments are sorted by first tick; find the last one starting at or before the target.
+    auto it = std::upper_bound(segments.begin(), segments.end(), tick,
+                               [](long long t, const Segment &segment) { return t < segment.firstTick; });
+    const Segment &segment = *(it - 1);
+
+    snapshot = segment.keyframe;
+    std::size_t deltaCount = static_cast<std::size_t>(tick - segment.firstTick);
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < deltaCount; i++) {
+        applyDelta(segment.deltas.data() + begin, segment.deltas.data() + segment.deltaEnds[i], snapshot);
+        begin = segment.deltaEnds[i];
+    }
+    return true;
+}
+
+void RewindBuffer::truncateAfter(long long tick) {
+    if (segments.empty() || tick >= getNewestTick())
+        return;
+    if (tick < getOldestTick()) {
+        clear();
+        return;
+    }
+
+    while (segments.back().firstTick > tick) {
+        memoryUsage -= segmentBytes(segments.back());
+        segments.pop_back();
+    }
+    Segment &segment = segments.back();
+    memoryUsage -= segmentBytes(segment);
+    std::size_t keep = static_cast<std::size_t>(tick - segment.firstTick);
+    segment.deltaEnds.resize(keep);
+    segment.deltas.resize(keep > 0 ? segment.deltaEnds.back() : 0);
+    memoryUsage += segmentBytes(segment);
+
+    seek(tick, newest);
+}
+
+void RewindBuffer::clear() {
+    segments.clear();
+    newest.clear();
+    memoryUsage = 0;
+}
+
+bool RewindBuffer::isEmpty() const {
+    return segments.empty();
+}
+
+long long RewindBuffer::getOldestTick() const {
+    return segments.empty() ? 0 : segments.front().firstTick;
+}
+
+long long RewindBuffer::getNewestTick() const {
+    if (segments.empty())
+        return -1;
+    return segments.back().firstTick + static_cast<long long>(segments.back().deltaEnds.size());
+}
+
+std::size_t RewindBuffer::getMemoryUsage() const {
+    return memoryUsage;
+}
@@ -1,100 +1,79 @@
 #include "Scene.h"
-#include <glad/glad.h>
+#include "Profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+// Radius of the sphere used for drone collisions; covers the propeller tips.
+static const float DRONE_RADIUS = 1.0f;
+
+// How often throughput statistics are printed.
+static const int STATS_INTERVAL_TICKS = 250;
+
+// Rewind history: a full keyframe every this many ticks, and the memory it may use.
+static const int REWIND_KEYFRAME_INTERVAL = 64;
+static const std::size_t REWIND_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+// Snapshot layout: this header, one angle per camera, then the drones' state
+// column by column: every drone's first state float, then every drone's second,
+// and so on. Each column is further split into byte planes (all first bytes,
+// then all second bytes, ...), so the sign and exponent bytes, which rarely
+// change from tick to tick, sit in long runs the rewind deltas skip over.
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t droneCount;
+    uint32_t cameraCount;
+    uint32_t reserved;
+    int64_t tick;
+};
+static const uint32_t SNAPSHOT_MAGIC = 0x324e5244; // "DRN2"
+
+// Drag applied by the wind per unit of air speed relative to the drone.
+static const float WIND_DRAG = 0.6f;
+// Fleets at least this large sample the wind on the worker threads.
+static const int WIND_PARALLEL_THRESHOLD = 16384;
+
+// Spacing between drones when the fleet is laid out on its home grid, and the height of its lowest layer.
+static const float FLEET_SPACING = 3.0f;
+static const float FLEET_HEIGHT = 2.0f;
+// Gap kept between a home's sphere and the walls and obstacles.
+static const float FLEET_CLEARANCE = 0.5f;
+// Fleets that do not fit at FLEET_SPACING are packed tighter in these steps,
+// down to a gap of FLEET_CLEARANCE between neighbouring drones.
+static const float FLEET_SPACING_STEP = 0.25f;
+static const float FLEET_MIN_SPACING = 2.0f * DRONE_RADIUS + FLEET_CLEARANCE;
+
+// Generated terrain maps: 32 x 32 tiles of 64 quads 2 m apart, about 4 km across.
+static const int TERRAIN_TILES = 32;
+static const float TERRAIN_SPACING = 2.0f;
+static const uint32_t TERRAIN_SEED = 7;
+// Height above the ground the fleet is lifted to when the terrain is enabled.
+static const float TERRAIN_CLEARANCE = 5.0f;
+// Far clipping plane of every camera over the terrain.
+static const float TERRAIN_FAR_CLIP = 1500.0f;
+// Where the global camera trails drone 0, and how high the chopper circles above it.
+static const glm::vec3 TERRAIN_GLOBAL_CAMERA_OFFSET(0.0f, 15.0f, 30.0f);
+static const float TERRAIN_CHOPPER_HEIGHT = 10.0f;
+
+Scene::Scene(int droneCount, uint32_t seed) : missions(*this), trajectorySeconds(0.0), collisionCount(0),
+                               wind(glm::vec3(-20.0f, 0.0f, -20.0f), glm::vec3(20.0f, 10.0f, 20.0f), 1.0f, seed),
+                               windEnabled(true), windSeconds(0.0), routes(environment, DRONE_RADIUS),
+                               lidarEnabled(true), tick(0), simulatedTicks(0),
+                               history(REWIND_KEYFRAME_INTERVAL, REWIND_MEMORY_BUDGET), historyEnabled(true),
+                               statsEnabled(true), paused(false), running(false) {
+    if (droneCount < 0)
+        droneCount = 0;
+    for (const glm::vec3 &home : layoutFleet(droneCount))
+        drones.push_back(Drone(home));
+    for (auto &drone : drones)
+        previousPositions.push_back(drone.getPosition());
+    teleports.assign(drones.size(), 0);
 
-#include <glm/gtc/matrix_transform.hpp>
-
-// Helper function to render a unit quad in the XY plane (z=0)
-static unsigned int quadVAO = 0, quadVBO = 0;
-static void initQuad()
-{
-    if (quadVAO != 0)
-        return;
-    float quadVertices[] = {
-            // positions (centered quad in XY plane)
-            -0.5f, -0.5f, 0.0f,
-            0.5f, -0.5f, 0.0f,
-            0.5f,  0.5f, 0.0f,
-            0.5f,  0.5f, 0.0f,
-            -0.5f,  0.5f, 0.0f,
-            -0.5f, -0.5f, 0.0f
-    };
-    glGenVertexArrays(1, &quadVAO);
-    glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
-}
-
-void Scene::renderWallMarkers(Shader* shader) {
-    initQuad(); // ensure the quad is initialised
-
-    shader->use();
-
-    // Define the color for the markers (orange).
-    glm::vec3 markerColor = glm::vec3(1.0f, 0.5f, 0.0f);
-
-    // We'll use a small square (scale it by 1.0) for each marker.
-    float markerScale = 1.0f;
-
-    // Back Wall: at z = -20, centered at (0, 5, -20).
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 5.0f, -20.0f));
-        model = glm::scale(model, glm::vec3(markerScale));
-        shader->setMat4("model", model);
-        shader->setVec3("objectColor", markerColor);
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
-
-    // Front Wall: at z = 20, centered at (0, 5, 20).
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 5.0f, 20.0f));
-        // Rotate 180° around Y so the square faces inward.
-        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0, 1, 0));
-        model = glm::scale(model, glm::vec3(markerScale));
-        shader->setMat4("model", model);
-        shader->setVec3("objectColor", markerColor);
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
-
-    // Left Wall: at x = -20, centered at (-20, 5, 0).
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-20.0f, 5.0f, 0.0f));
-        // Rotate 90° around Y so that the square lies on the wall.
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0, 1, 0));
-        model = glm::scale(model, glm::vec3(markerScale));
-        shader->setMat4("model", model);
-        shader->setVec3("objectColor", markerColor);
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
-
-    // Right Wall: at x = 20, centered at (20, 5, 0).
-    {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(20.0f, 5.0f, 0.0f));
-        // Rotate -90° around Y so that the square lies on the wall.
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0, 1, 0));
-        model = glm::scale(model, glm::vec3(markerScale));
-        shader->setMat4("model", model);
-        shader->setVec3("objectColor", markerColor);
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
-
-    glBindVertexArray(0);
-}
-
-Scene::Scene(int width, int height) : activeCameraIndex(0), screenWidth(width), screenHeight(height) {
     // Global camera: fixed position to view the entire scene.
     Camera* globalCamera = new Camera(GLOBAL);
     globalCamera->setPosition(glm::vec3(0.0f, 5.0f, 10.0f));
@@ -115,116 +94,673 @@ Scene::Scene(int width, int height) : activeCameraIndex(0), screenWidth(width),
     cameras.push_back(globalCamera);
     cameras.push_back(chopperCamera);
     cameras.push_back(fpCamera);
+
+    // The initial state is the first entry of the rewind history, and the first one published.
+    recordHistory();
+    publish();
+}
+
+Scene::~Scene() {
+    stop();
+}
+
+std::vector<glm::vec3> Scene::layoutFleet(int droneCount) const {
+    const float w = Environment::ROOM_HALF_WIDTH;
+    const float reach = DRONE_RADIUS + FLEET_CLEARANCE;
+
+    // Square grids centred on the origin, grown until the free homes suffice;
+    // once a grid spans the room, further layers stack upwards while their
+    // top stays below `ceiling`.
+    std::vector<glm::vec3> homes;
+    auto layout = [&](float spacing, float ceiling) {
+        int maxSide = static_cast<int>(2.0f * (w - reach) / spacing) + 1;
+        int side = std::min(static_cast<int>(std::ceil(std::sqrt(static_cast<float>(droneCount)))), maxSide);
+        auto addLayer = [&](int layer) {
+            for (int i = 0; i < side * side && static_cast<int>(homes.size()) < droneCount; i++) {
+                glm::vec3 home((i % side - (side - 1) * 0.5f) * spacing, FLEET_HEIGHT + layer * spacing,
+                               (i / side - (side - 1) * 0.5f) * spacing);
+                bool inside = std::fabs(home.x) + reach <= w && std::fabs(home.z) + reach <= w;
+                if (inside && !environment.overlapsSphere(home, reach))
+                    homes.push_back(home);
+            }
+        };
+        homes.clear();
+        addLayer(0);
+        while (static_cast<int>(homes.size()) < droneCount && side < maxSide) {
+            side++;
+            homes.clear();
+            addLayer(0);
+        }
+        for (int layer = 1; static_cast<int>(homes.size()) < droneCount; layer++) {
+            if (FLEET_HEIGHT + layer * spacing + reach > ceiling)
+                break;
+            addLayer(layer);
+        }
+        return static_cast<int>(homes.size()) >= droneCount;
+    };
+
+    // Tighten the grid down to the minimum spacing before giving up on the
+    // room; past that, the layers carry on above the walls, as the room has
+    // no ceiling.
+    for (float spacing = FLEET_SPACING; spacing > FLEET_MIN_SPACING - 1e-3f; spacing -= FLEET_SPACING_STEP) {
+        if (layout(spacing, Environment::ROOM_HEIGHT))
+            return homes;
+    }
+    layout(FLEET_MIN_SPACING, INFINITY);
+    return homes;
 }
 
 void Scene::update() {
-    float deltaTime = 0.016f;
+    PROFILE_ZONE("Scene::update");
+    executeCommands();
+    if (paused)
+        return;
+    step();
+    recordHistory();
+}
+
+void Scene::start() {
+    if (running)
+        return;
+    running = true;
+    simulationThread = std::thread(&Scene::runSimulation, this);
+}
+
+void Scene::stop() {
+    if (!running)
+        return;
+    running = false;
+    simulationThread.join();
+}
 
-    // Update the drone's state.
-    drone.update(deltaTime);
+void Scene::runSimulation() {
+    PROFILE_THREAD("simulation");
+    using clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(TICK_SECONDS));
+    auto next = clock::now();
+    while (running) {
+        update();
+        publish();
+
+        // Hold the tick rate; if we fell far behind, catch up from now instead of bursting.
+        next += period;
+        auto now = clock::now();
+        if (now > next + 4 * period)
+            next = now;
+        else
+            std::this_thread::sleep_until(next);
+    }
+}
+
+void Scene::post(std::function<void(Scene&)> command) {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    pendingCommands.push_back(std::move(command));
+}
+
+void Scene::executeCommands() {
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        runningCommands.swap(pendingCommands);
+    }
+    for (auto &command : runningCommands)
+        command(*this);
+    runningCommands.clear();
+}
+
+void Scene::publish() {
+    WorldState &state = states.getWriteBuffer();
+    state.tick = tick;
+    state.drones = drones;
+    state.cameras.clear();
+    for (auto cam : cameras)
+        state.cameras.push_back(*cam);
+    state.teleports = teleports;
+    states.publish();
+}
+
+const WorldState &Scene::acquireLatestState(bool* updated) {
+    return states.acquire(updated);
+}
+
+long long Scene::getSimulatedTicks() const {
+    return simulatedTicks.load(std::memory_order_relaxed);
+}
+
+void Scene::step() {
+    float deltaTime = TICK_SECONDS;
+
+    {
+        PROFILE_ZONE("Scene::missions");
+        missions.update(deltaTime);
+        if (routes.getActiveCount() > 0)
+            updateRoutes();
+        if (trajectories.getFollowerCount() > 0)
+            followTrajectories(deltaTime);
+    }
+
+    if (windEnabled)
+        applyWind(deltaTime);
+
+    // Update every drone's state and sweep its motion since the last tick
+    // against the obstacles.
+    {
+        PROFILE_ZONE("Scene::moveDrones");
+        for (size_t i = 0; i < drones.size(); i++) {
+            drones[i].update(deltaTime);
+
+            glm::vec3 position = drones[i].getPosition();
+            bool collided;
+            glm::vec3 resolved = environment.sweepSphere(previousPositions[i], position, DRONE_RADIUS, collided);
+            if (terrain) {
+                // The ground is not in the BVH; keep the drone's sphere above it.
+                float ground = terrain->heightAt(resolved.x, resolved.z) + DRONE_RADIUS;
+                if (resolved.y < ground) {
+                    resolved.y = ground;
+                    collided = true;
+                }
+            }
+            if (collided) {
+                collisionCount++;
+                drones[i].setPosition(resolved);
+                drones[i].setVelocity(glm::vec3(0.0f));
+            }
+            previousPositions[i] = resolved;
+        }
+    }
+
+    if (lidarEnabled) {
+        PROFILE_ZONE("Lidar::scan");
+        lidar.scan(environment.getBvh(), drones, workers);
+    }
+
+    tick++;
+    simulatedTicks.fetch_add(1, std::memory_order_relaxed);
+    if (telemetry.isOpen()) {
+        for (size_t i = 0; i < drones.size(); i++)
+            telemetry.append(getSimTime(), static_cast<uint32_t>(i), drones[i].getPosition(), drones[i].getRotation());
+    }
+    updateCameras(deltaTime);
+
+    if (statsEnabled && tick % STATS_INTERVAL_TICKS == 0)
+        reportStats();
+}
+
+// Advance the wind and push every drone with the drag of the air moving past it.
+void Scene::applyWind(float deltaTime) {
+    PROFILE_ZONE("Scene::applyWind");
+    auto start = std::chrono::steady_clock::now();
+    wind.advance(deltaTime);
+
+    int count = static_cast<int>(drones.size());
+    windPositionsX.resize(count);
+    windPositionsY.resize(count);
+    windPositionsZ.resize(count);
+    windX.resize(count);
+    windY.resize(count);
+    windZ.resize(count);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position = drones[i].getPosition();
+        windPositionsX[i] = position.x;
+        windPositionsY[i] = position.y;
+        windPositionsZ[i] = position.z;
+    }
+
+    auto sampleRange = [this](int begin, int end) {
+        wind.sampleBatch(&windPositionsX[begin], &windPositionsY[begin], &windPositionsZ[begin], end - begin,
+                         &windX[begin], &windY[begin], &windZ[begin]);
+    };
+    if (count >= WIND_PARALLEL_THRESHOLD)
+        workers.parallelFor(count, sampleRange);
+    else
+        sampleRange(0, count);
+
+    for (int i = 0; i < count; i++) {
+        glm::vec3 air(windX[i], windY[i], windZ[i]);
+        drones[i].applyForce((air - drones[i].getVelocity()) * WIND_DRAG);
+    }
+    windSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Move every drone on a path to its next pose along it. Like missions, paths
+// place the drones directly; the sweep below still stops them at obstacles.
+void Scene::followTrajectories(float deltaTime) {
+    auto start = std::chrono::steady_clock::now();
+    trajectories.advance(deltaTime);
+    for (int f = 0; f < trajectories.getFollowerCount(); f++) {
+        Drone &drone = drones[trajectories.getFollowerDrone(f)];
+        glm::vec3 rotation = trajectories.getRotation(f);
+        drone.setPosition(trajectories.getPosition(f));
+        drone.setRotation(glm::vec3(rotation.x, rotation.y, drone.getRotation().z));
+    }
+    trajectorySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Start the plans that are due and put every drone with a new plan on it.
+void Scene::updateRoutes() {
+    routes.update(drones, tick);
+    routes.collectResults(routeResults);
+    for (auto &plan : routeResults) {
+        if (!plan.found)
+            continue;
+        // The drone has moved on while the plan was made.
+        plan.waypoints[0] = drones[plan.drone].getPosition();
+        int path = trajectories.addPath(plan.waypoints, false);
+        // No second distinct waypoint: the drone is already at its goal, so
+        // it keeps hovering at the end of the path it is on.
+        if (path < 0)
+            continue;
+        int previous = routePaths[plan.drone];
+        trajectories.follow(plan.drone, path, routeSpeeds[plan.drone]);
+        trajectories.releasePath(previous);
+        routePaths[plan.drone] = path;
+    }
+}
+
+void Scene::reportStats() {
+    if (lidarEnabled) {
+        std::cout << "Lidar: " << lidar.getRaysPerDrone() << " rays/drone, "
+                  << static_cast<long long>(lidar.getRaysPerSecond()) << " rays/s" << std::endl;
+        lidar.resetStats();
+    }
+    if (missions.getActiveCount() > 0) {
+        std::cout << "Missions: " << missions.getActiveCount() << " active, "
+                  << static_cast<double>(missions.getResumeCount()) / STATS_INTERVAL_TICKS << " resumed/tick" << std::endl;
+    }
+    missions.resetStats();
+    if (trajectories.getFollowerCount() > 0) {
+        std::cout << "Trajectories: " << trajectories.getFollowerCount() << " drones on paths, "
+                  << trajectorySeconds * 1e6 / STATS_INTERVAL_TICKS << " us/tick, "
+                  << trajectories.getMemoryUsage() / 1024 << " KB" << std::endl;
+    }
+    trajectorySeconds = 0.0;
+    if (routes.getActiveCount() > 0) {
+        std::cout << "Routes: " << routes.getActiveCount() << " active, " << routes.getPlansPerSecond() << " plans/s; "
+                  << routes.getPlanCount() << " new at " << routes.getAveragePlanExpansions() << " expansions, "
+                  << routes.getAveragePlanMicros() << " us; " << routes.getReplanCount() << " replans at "
+                  << routes.getAverageReplanExpansions() << " expansions, " << routes.getAverageReplanMicros() << " us; "
+                  << routes.getMemoryUsage() / 1024 << " KB" << std::endl;
+    }
+    routes.resetStats();
+    if (windEnabled) {
+        std::cout << "Wind: " << drones.size() << " drones sampled in "
+                  << windSeconds * 1000.0 / STATS_INTERVAL_TICKS << " ms/tick, grid "
+                  << wind.getMemoryUsage() / 1024 << " KB" << std::endl;
+    }
+    windSeconds = 0.0;
+    std::cout << "Rewind: " << (history.getNewestTick() - history.getOldestTick()) * TICK_SECONDS << " s buffered in "
+              << history.getMemoryUsage() / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+void Scene::updateCameras(float deltaTime) {
+    PROFILE_ZONE("Scene::updateCameras");
+    // An empty world (e.g. a shard whose drones all left) has nothing to follow.
+    if (drones.empty())
+        return;
+    Drone &drone = drones[0];
 
     // Update the chopper camera.
     for (auto cam : cameras) {
         if (cam->getType() == CHOPPER) {
             cam->update(deltaTime); // This updates its position
+            if (terrain) {
+                // Circle the drone rather than the centre of the room.
+                glm::vec3 orbit = cam->getPosition();
+                cam->setPosition(drone.getPosition() + glm::vec3(orbit.x, TERRAIN_CHOPPER_HEIGHT, orbit.z));
+            }
             // Now update its target so that it always looks at the drone.
             cam->setTarget(drone.getPosition());
         }
     }
 
+    // Out in the open a fixed global camera would soon lose the drone.
+    if (terrain) {
+        cameras[0]->setPosition(drone.getPosition() + TERRAIN_GLOBAL_CAMERA_OFFSET);
+        cameras[0]->setTarget(drone.getPosition());
+    }
+
     // Update the first-person camera.
-    Camera* fpCamera = cameras[2];
-    // Adjust the offset
-    glm::vec3 cockpitOffset = glm::vec3(0.0f, 0.3f, -0.5f);
-    float yaw = glm::radians(drone.getRotation().y);
-    glm::mat4 rotationMat = glm::rotate(glm::mat4(1.0f), yaw, glm::vec3(0, 1, 0));
-    glm::vec3 rotatedOffset = glm::vec3(rotationMat * glm::vec4(cockpitOffset, 1.0f));
-
-    fpCamera->setPosition(drone.getPosition() + rotatedOffset);
-    // The target for the cockpit camera is set in the drone's forward direction.
-    fpCamera->setTarget(drone.getPosition() + drone.getFront());
-}
-
-// Render coordinate axes at the origin.
-void Scene::renderMarkers(Shader* shader) {
-    static unsigned int markerVAO = 0, markerVBO = 0;
-    if (markerVAO == 0) {
-        float markers[] = {
-                // X axis: from (0,0,0) to (1,0,0)
-                0.0f, 0.0f, 0.0f,
-                1.0f, 0.0f, 0.0f,
-                // Y axis: from (0,0,0) to (0,1,0)
-                0.0f, 0.0f, 0.0f,
-                0.0f, 1.0f, 0.0f,
-                // Z axis: from (0,0,0) to (0,0,1)
-                0.0f, 0.0f, 0.0f,
-                0.0f, 0.0f, 1.0f
+    cameras[2]->followCockpit(drone);
+}
+
+Drone* Scene::getDrone() {
+    return &drones[0];
+}
+
+Drone* Scene::getDrone(int index) {
+    return &drones[index];
+}
+
+int Scene::getDroneCount() const {
+    return static_cast<int>(drones.size());
+}
+
+void Scene::resetDrone(int index) {
+    drones[index].reset();
+    previousPositions[index] = drones[index].getPosition();
+    teleports[index]++;
+}
+
+int Scene::addDrone(const Drone &drone) {
+    drones.push_back(drone);
+    previousPositions.push_back(drone.getPosition());
+    teleports.push_back(0);
+    return static_cast<int>(drones.size()) - 1;
+}
+
+void Scene::removeDrone(int index) {
+    int last = static_cast<int>(drones.size()) - 1;
+    trajectories.removeDrone(index, last);
+    drones[index] = drones[last];
+    previousPositions[index] = previousPositions[last];
+    teleports[index] = teleports[last] + 1;
+    drones.pop_back();
+    previousPositions.pop_back();
+    teleports.pop_back();
+}
+
+void Scene::placeDrone(int index, const glm::vec3 &position, const glm::vec3 &rotation) {
+    drones[index].setPosition(position);
+    drones[index].setRotation(rotation);
+    previousPositions[index] = position;
+    teleports[index]++;
+}
+
+long long Scene::getCollisionCount() const {
+    return collisionCount;
+}
+
+const Environment &Scene::getEnvironment() const {
+    return environment;
+}
+
+bool Scene::enableTerrain(const std::string &path) {
+    auto map = std::make_unique<TerrainMap>();
+    if (!map->open(path)) {
+        // Only generate a missing map; never overwrite a file we cannot read.
+        if (std::ifstream(path).good())
+            return false;
+        std::cout << "Generating terrain map " << path << std::endl;
+        if (!TerrainMap::generate(path, TERRAIN_TILES, TERRAIN_TILES, TERRAIN_SPACING, TERRAIN_SEED) || !map->open(path))
+            return false;
+    }
+    terrain = std::move(map);
+    environment.clear();
+
+    // Lift the fleet clear of the ground.
+    for (size_t i = 0; i < drones.size(); i++) {
+        glm::vec3 position = drones[i].getPosition();
+        position.y = terrain->heightAt(position.x, position.z) + TERRAIN_CLEARANCE;
+        drones[i].setPosition(position);
+        previousPositions[i] = position;
+        teleports[i]++;
+    }
+    for (auto cam : cameras)
+        cam->setFarClip(TERRAIN_FAR_CLIP);
+    updateCameras(0.0f);
+
+    // The history and the published state start over from here.
+    history.clear();
+    recordHistory();
+    publish();
+    return true;
+}
+
+const TerrainMap* Scene::getTerrain() const {
+    return terrain.get();
+}
+
+MissionScheduler &Scene::getMissions() {
+    return missions;
+}
+
+void Scene::startDemoMissions() {
+    for (int i = 0; i < getDroneCount(); i++) {
+        if (!missions.hasMission(i) && !trajectories.isFollowing(i))
+            missions.start(patrolMission(drones[i].getHome(), 0.1f * (i % 20)), i);
+    }
+}
+
+TrajectoryEngine &Scene::getTrajectories() {
+    return trajectories;
+}
+
+void Scene::startDemoTrajectories() {
+    for (int i = 0; i < getDroneCount(); i++) {
+        if (missions.hasMission(i))
+            continue;
+        // A loop of six waypoints starting where the drone is, with a radius,
+        // heights and speed of its own.
+        uint32_t h = static_cast<uint32_t>(i) * 0x9e3779b1u;
+        auto next = [&h]() {
+            h ^= h >> 15;
+            h *= 0x2c1b3c6du;
+            h ^= h >> 12;
+            return (h & 0xffff) / 65535.0f;
         };
+        glm::vec3 start = drones[i].getPosition();
+        glm::vec3 centre = drones[i].getHome() + glm::vec3(0.0f, 1.5f, 0.0f);
+        float radius = 1.0f + 1.5f * next();
+        float phase = 6.2831853f * next();
+        std::vector<glm::vec3> waypoints = {start};
+        for (int k = 0; k < 6; k++) {
+            float angle = phase + k * 1.0471976f;
+            float height = std::max(centre.y + 2.0f * (next() - 0.5f), DRONE_RADIUS + 0.5f);
+            waypoints.push_back(glm::vec3(centre.x + radius * std::cos(angle), height, centre.z + radius * std::sin(angle)));
+        }
+        trajectories.follow(i, trajectories.addPath(waypoints, true), 1.5f + 2.0f * next());
+    }
+}
 
-        glGenVertexArrays(1, &markerVAO);
-        glGenBuffers(1, &markerVBO);
-        glBindVertexArray(markerVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, markerVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(markers), markers, GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glBindVertexArray(0);
+void Scene::stopTrajectories() {
+    // Routed drones would be left without a path, so their routes go too.
+    routes.cancelAll();
+    routePaths.assign(routePaths.size(), -1);
+    trajectories.clear();
+}
+
+bool Scene::hasTrajectories() const {
+    return trajectories.getFollowerCount() > 0;
+}
+
+void Scene::requestRoute(int drone, const glm::vec3 &goal, float speed) {
+    if (drone >= static_cast<int>(routePaths.size())) {
+        routePaths.resize(drone + 1, -1);
+        routeSpeeds.resize(drone + 1, 0.0f);
     }
+    routeSpeeds[drone] = speed;
+    routes.request(drone, goal);
+}
 
-    shader->use();
-    glm::mat4 model = glm::mat4(1.0f);
-    shader->setMat4("model", model);
+void Scene::cancelRoute(int drone) {
+    routes.cancel(drone);
+    if (drone < static_cast<int>(routePaths.size()) && routePaths[drone] >= 0) {
+        trajectories.stop(drone);
+        trajectories.releasePath(routePaths[drone]);
+        routePaths[drone] = -1;
+    }
+}
 
-    glBindVertexArray(markerVAO);
+bool Scene::isRouteFailed(int drone) const {
+    return routes.hasFailed(drone);
+}
 
-    // Draw X axis in red.
-    shader->setVec3("objectColor", glm::vec3(1.0f, 0.0f, 0.0f));
-    glDrawArrays(GL_LINES, 0, 2);
+RoutePlanner &Scene::getRoutes() {
+    return routes;
+}
 
-    // Draw Y axis in green.
-    shader->setVec3("objectColor", glm::vec3(0.0f, 1.0f, 0.0f));
-    glDrawArrays(GL_LINES, 2, 2);
+void Scene::startDemoRoutes() {
+    for (int i = 0; i < getDroneCount(); i++) {
+        if (!missions.hasMission(i) && !trajectories.isFollowing(i))
+            missions.start(courierMission(drones[i].getHome(), static_cast<uint32_t>(i)), i);
+    }
+}
 
-    // Draw Z axis in blue.
-    shader->setVec3("objectColor", glm::vec3(0.0f, 0.0f, 1.0f));
-    glDrawArrays(GL_LINES, 4, 2);
+void Scene::setWindEnabled(bool enabled) {
+    windEnabled = enabled;
+}
 
-    glBindVertexArray(0);
+bool Scene::isWindEnabled() const {
+    return windEnabled;
 }
 
-void Scene::render(Shader* shader) {
-    // Set up the active camera.
-    Camera* cam = getActiveCamera();
+WindField &Scene::getWindField() {
+    return wind;
+}
 
-    // Use the shader and set the view and projection matrices.
-    shader->use();
-    shader->setMat4("view", cam->getViewMatrix());
-    shader->setMat4("projection", cam->getProjectionMatrix());
+void Scene::setLidarEnabled(bool enabled) {
+    lidarEnabled = enabled;
+}
 
-    // Render the ground plane.
-    glm::mat4 groundModel = glm::mat4(1.0f);
-    groundModel = glm::scale(groundModel, glm::vec3(40.0f, 1.0f, 40.0f));
-    shader->setMat4("model", groundModel);
-    shader->setVec3("objectColor", glm::vec3(0.3f, 0.8f, 0.3f));
+const Lidar &Scene::getLidar() const {
+    return lidar;
+}
 
-    // Render markers to indicate 3D space.
-    renderMarkers(shader);
-    renderWallMarkers(shader);
+bool Scene::startRecording(const std::string &path) {
+    return telemetry.open(path);
+}
 
-    // Render the drone.
-    drone.render(shader);
+void Scene::stopRecording() {
+    if (telemetry.isOpen())
+        std::cout << "Telemetry: " << telemetry.getRowsWritten() << " rows recorded" << std::endl;
+    telemetry.close();
 }
 
-Drone* Scene::getDrone() {
-    return &drone;
+void Scene::saveSnapshot(std::vector<unsigned char> &blob) const {
+    SnapshotHeader header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.droneCount = static_cast<uint32_t>(drones.size());
+    header.cameraCount = static_cast<uint32_t>(cameras.size());
+    header.reserved = 0;
+    header.tick = tick;
+
+    std::size_t n = drones.size();
+    std::size_t anglesBytes = cameras.size() * sizeof(float);
+    blob.resize(sizeof(header) + anglesBytes + n * Drone::STATE_FLOATS * sizeof(float));
+
+    unsigned char* out = blob.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (auto cam : cameras) {
+        float angle = cam->getAngle();
+        std::memcpy(out, &angle, sizeof(float));
+        out += sizeof(float);
+    }
+
+    // Scatter each drone's state into its column and byte planes.
+    float state[Drone::STATE_FLOATS];
+    unsigned char bytes[sizeof(state)];
+    for (std::size_t i = 0; i < n; i++) {
+        drones[i].saveState(state);
+        std::memcpy(bytes, state, sizeof(state));
+        for (std::size_t b = 0; b < sizeof(state); b++)
+            out[b * n + i] = bytes[b];
+    }
+}
+
+bool Scene::restoreSnapshot(const std::vector<unsigned char> &blob) {
+    SnapshotHeader header;
+    if (blob.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, blob.data(), sizeof(header));
+    std::size_t n = drones.size();
+    std::size_t anglesBytes = cameras.size() * sizeof(float);
+    if (header.magic != SNAPSHOT_MAGIC || header.droneCount != n || header.cameraCount != cameras.size() ||
+        blob.size() != sizeof(header) + anglesBytes + n * Drone::STATE_FLOATS * sizeof(float))
+        return false;
+
+    const unsigned char* in = blob.data() + sizeof(header);
+    for (auto cam : cameras) {
+        float angle;
+        std::memcpy(&angle, in, sizeof(float));
+        cam->setAngle(angle);
+        in += sizeof(float);
+    }
+
+    float state[Drone::STATE_FLOATS];
+    unsigned char bytes[sizeof(state)];
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t b = 0; b < sizeof(state); b++)
+            bytes[b] = in[b * n + i];
+        std::memcpy(state, bytes, sizeof(state));
+        drones[i].restoreState(state);
+    }
+    tick = header.tick;
+
+    // The restored positions are where the next sweep starts from.
+    for (size_t i = 0; i < n; i++) {
+        previousPositions[i] = drones[i].getPosition();
+        teleports[i]++;
+    }
+    updateCameras(0.0f);
+    return true;
+}
+
+long long Scene::getTick() const {
+    return tick;
+}
+
+float Scene::getSimTime() const {
+    return tick * TICK_SECONDS;
+}
+
+void Scene::setHistoryEnabled(bool enabled) {
+    historyEnabled = enabled;
+    if (!enabled)
+        history.clear();
+}
+
+void Scene::setStatsEnabled(bool enabled) {
+    statsEnabled = enabled;
+}
+
+void Scene::recordHistory() {
+    if (!historyEnabled)
+        return;
+    saveSnapshot(snapshotScratch);
+    history.record(tick, snapshotScratch);
+}
+
+bool Scene::seekHistory(long long target) {
+    if (!history.seek(target, snapshotScratch))
+        return false;
+    // History recorded before the fleet changed size no longer fits it; start over from now.
+    if (!restoreSnapshot(snapshotScratch)) {
+        std::cerr << "Rewind: recorded history does not match the current fleet, discarding it" << std::endl;
+        history.clear();
+        recordHistory();
+        return false;
+    }
+    // Once running again, the world diverges from whatever was recorded after this point.
+    if (!paused)
+        history.truncateAfter(tick);
+    return true;
+}
+
+void Scene::setPaused(bool pause) {
+    if (paused && !pause)
+        history.truncateAfter(tick);
+    paused = pause;
 }
 
-void Scene::setActiveCamera(int index) {
-    if(index >= 0 && index < cameras.size()) {
-        activeCameraIndex = index;
+bool Scene::isPaused() const {
+    return paused;
+}
+
+void Scene::stepBack() {
+    seekHistory(tick - 1);
+}
+
+void Scene::stepForward() {
+    // Replay recorded history first; simulate only past its end.
+    if (tick < history.getNewestTick()) {
+        seekHistory(tick + 1);
+        return;
     }
+    step();
+    recordHistory();
 }
 
-Camera* Scene::getActiveCamera() {
-    return cameras[activeCameraIndex];
+void Scene::rewind(float seconds) {
+    long long target = tick - static_cast<long long>(seconds / TICK_SECONDS);
+    seekHistory(std::max(target, history.getOldestTick()));
 }
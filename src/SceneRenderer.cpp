@@ -0,0 +1,320 @@
+#include "SceneRenderer.h"
+#include "Profiler.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+
+// Flight trail history: how far back it reaches and how much GPU memory it may use.
+static const float TRAIL_SECONDS = 10.0f;
+static const std::size_t TRAIL_MEMORY_BUDGET = 16 * 1024 * 1024;
+
+// Resolution of the per-drone cockpit sensor images.
+static const int SENSOR_WIDTH = 64;
+static const int SENSOR_HEIGHT = 48;
+// Upper bound of the sensor texture arrays and readback buffers.
+static const std::size_t SENSOR_MEMORY_BUDGET = 64 * 1024 * 1024;
+// Radius of a sphere around a drone and its propellers, for culling sensor views.
+static const float SENSOR_CULL_RADIUS = 1.0f;
+
+// How often sensor statistics are printed, in rendered frames.
+static const int STATS_INTERVAL_FRAMES = 250;
+
+// Upper bound of the terrain tile meshes kept on the GPU.
+static const std::size_t TERRAIN_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+// Helper function to render a unit quad in the XY plane (z=0)
+static unsigned int quadVAO = 0, quadVBO = 0;
+static void initQuad()
+{
+    if (quadVAO != 0)
+        return;
+    float quadVertices[] = {
+            // positions (centered quad in XY plane)
+            -0.5f, -0.5f, 0.0f,
+            0.5f, -0.5f, 0.0f,
+            0.5f,  0.5f, 0.0f,
+            0.5f,  0.5f, 0.0f,
+            -0.5f,  0.5f, 0.0f,
+            -0.5f, -0.5f, 0.0f
+    };
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+void SceneRenderer::renderWallMarkers(Shader* shader) {
+    initQuad(); // ensure the quad is initialised
+
+    shader->use();
+
+    // Define the color for the markers (orange).
+    glm::vec3 markerColor = glm::vec3(1.0f, 0.5f, 0.0f);
+
+    // We'll use a small square (scale it by 1.0) for each marker.
+    float markerScale = 1.0f;
+
+    // Back Wall: at z = -20, just off its face at (0, 5, -19.99).
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, 5.0f, -19.99f));
+        model = glm::scale(model, glm::vec3(markerScale));
+        shader->setMat4("model", model);
+        shader->setVec3("objectColor", markerColor);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    // Front Wall: at z = 20, just off its face at (0, 5, 19.99).
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, 5.0f, 19.99f));
+        // Rotate 180° around Y so the square faces inward.
+        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0, 1, 0));
+        model = glm::scale(model, glm::vec3(markerScale));
+        shader->setMat4("model", model);
+        shader->setVec3("objectColor", markerColor);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    // Left Wall: at x = -20, just off its face at (-19.99, 5, 0).
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(-19.99f, 5.0f, 0.0f));
+        // Rotate 90° around Y so that the square lies on the wall.
+        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0, 1, 0));
+        model = glm::scale(model, glm::vec3(markerScale));
+        shader->setMat4("model", model);
+        shader->setVec3("objectColor", markerColor);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    // Right Wall: at x = 20, just off its face at (19.99, 5, 0).
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(19.99f, 5.0f, 0.0f));
+        // Rotate -90° around Y so that the square lies on the wall.
+        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0, 1, 0));
+        model = glm::scale(model, glm::vec3(markerScale));
+        shader->setMat4("model", model);
+        shader->setVec3("objectColor", markerColor);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    glBindVertexArray(0);
+}
+
+SceneRenderer::SceneRenderer(Scene &scene, int width, int height)
+    : scene(scene), activeCameraIndex(0), screenWidth(width), screenHeight(height),
+      trails(scene.getDroneCount(), TRAIL_SECONDS, Scene::TICK_SECONDS, TRAIL_MEMORY_BUDGET),
+      sensors(SENSOR_WIDTH, SENSOR_HEIGHT, scene.getDroneCount(), SENSOR_MEMORY_BUDGET), sensorMode(false),
+      sensorCamera(FIRST_PERSON), renderedFrames(0)
+{
+    sensorCamera.setAspectRatio(static_cast<float>(SENSOR_WIDTH) / SENSOR_HEIGHT);
+    if (scene.getTerrain())
+        terrain = std::make_unique<TerrainRenderer>(*scene.getTerrain(), TERRAIN_MEMORY_BUDGET);
+}
+
+void SceneRenderer::render(Shader* shader) {
+    PROFILE_ZONE("SceneRenderer::render");
+    bool updated;
+    const WorldState &state = scene.acquireLatestState(&updated);
+    if (state.cameras.empty())
+        return; // Nothing published yet.
+    if (updated)
+        appendTrails(state);
+
+    // Set up the active camera.
+    const Camera &cam = state.cameras[activeCameraIndex];
+
+    // Use the shader and set the view and projection matrices.
+    shader->use();
+    shader->setMat4("view", cam.getViewMatrix());
+    shader->setMat4("projection", cam.getProjectionMatrix());
+
+    // Render the axes at the origin; lines stay out of renderWorld so the
+    // triangle-only sensor pass can share it.
+    renderMarkers(shader);
+    renderWorld(state, shader);
+
+    // The terrain is drawn with its own shader, and only in the main view.
+    if (terrain) {
+        terrain->render(cam.getViewMatrix(), cam.getProjectionMatrix(), cam.getPosition());
+        if (renderedFrames % STATS_INTERVAL_FRAMES == STATS_INTERVAL_FRAMES - 1) {
+            std::cout << "Terrain: " << terrain->getDrawnTiles() << " tiles drawn, " << terrain->getCachedTiles()
+                      << " cached in " << terrain->getMemoryUsage() / (1024.0 * 1024.0) << " MB, "
+                      << terrain->getPendingBuilds() << " building, " << terrain->getEvictions() << " evicted" << std::endl;
+        }
+    }
+
+    // Render the flight trails with their own shader.
+    trails.render(cam.getViewMatrix(), cam.getProjectionMatrix());
+
+    if (sensorMode) {
+        PROFILE_ZONE("SceneRenderer::renderSensors");
+        renderSensors(state);
+    }
+    renderedFrames++;
+}
+
+// Trails are sampled once per newly published state, i.e. at the lower of the sim and render rates.
+void SceneRenderer::appendTrails(const WorldState &state) {
+    trailSamples.resize(state.drones.size());
+    trailTeleports.resize(state.teleports.size(), 0);
+    for (size_t i = 0; i < state.drones.size(); i++) {
+        // A teleported drone starts a fresh trail instead of drawing a line across the room.
+        if (state.teleports[i] != trailTeleports[i]) {
+            trails.clear(static_cast<int>(i));
+            trailTeleports[i] = state.teleports[i];
+        }
+        trailSamples[i] = state.drones[i].getPosition();
+    }
+    trails.append(trailSamples);
+}
+
+// The six planes of a view-projection's frustum, normals pointing inwards.
+static void frustumPlanes(const glm::mat4 &m, glm::vec4 planes[6]) {
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; r++)
+        rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+    for (int axis = 0; axis < 3; axis++) {
+        planes[axis * 2] = rows[3] + rows[axis];
+        planes[axis * 2 + 1] = rows[3] - rows[axis];
+    }
+    for (int i = 0; i < 6; i++)
+        planes[i] = planes[i] / glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+}
+
+static bool sphereInFrustum(const glm::vec4 planes[6], const glm::vec3 &centre, float radius) {
+    for (int i = 0; i < 6; i++) {
+        if (planes[i].x * centre.x + planes[i].y * centre.y + planes[i].z * centre.z + planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+void SceneRenderer::renderWorld(const WorldState &state, Shader* shader, const glm::mat4* cullViews, int cullCount) {
+    // Render the floor, walls and obstacles.
+    scene.getEnvironment().render(shader);
+
+    // Render markers on the walls to indicate 3D space; out on the terrain there are no walls.
+    if (!scene.getTerrain())
+        renderWallMarkers(shader);
+
+    // Render the fleet.
+    if (!cullViews) {
+        for (auto &drone : state.drones)
+            drone.render(shader);
+        return;
+    }
+    cullPlanes.resize(cullCount * 6);
+    for (int v = 0; v < cullCount; v++)
+        frustumPlanes(cullViews[v], &cullPlanes[v * 6]);
+    for (auto &drone : state.drones) {
+        glm::vec3 centre = drone.getPosition();
+        for (int v = 0; v < cullCount; v++) {
+            if (sphereInFrustum(&cullPlanes[v * 6], centre, SENSOR_CULL_RADIUS)) {
+                drone.render(shader);
+                break;
+            }
+        }
+    }
+}
+
+// Render every drone's cockpit view in one batched pass and collect finished readbacks.
+void SceneRenderer::renderSensors(const WorldState &state) {
+    sensorViews.resize(state.drones.size());
+    {
+        PROFILE_ZONE("SceneRenderer::updateSensorCameras");
+        for (size_t i = 0; i < state.drones.size(); i++) {
+            sensorCamera.followCockpit(state.drones[i]);
+            sensorViews[i] = sensorCamera.getProjectionMatrix() * sensorCamera.getViewMatrix();
+        }
+    }
+    sensors.capture(state.tick, sensorViews, [&](Shader* sensorShader, const glm::mat4* passViews, int passCount) {
+        renderWorld(state, sensorShader, passViews, passCount);
+    });
+
+    if (renderedFrames % STATS_INTERVAL_FRAMES == STATS_INTERVAL_FRAMES - 1) {
+        std::cout << "Sensors: " << std::min(static_cast<int>(state.drones.size()), sensors.getMaxViews()) << " of "
+                  << state.drones.size() << " views per frame at " << sensors.getWidth() << "x" << sensors.getHeight()
+                  << ", " << sensors.getFramesPerSecond() << " frames/s, "
+                  << sensors.getMegabytesPerSecond() << " MB/s, "
+                  << sensors.getAverageLatency() * 1000.0 << " ms latency, "
+                  << sensors.getDroppedFrames() << " dropped" << std::endl;
+        sensors.resetStats();
+    }
+}
+
+void SceneRenderer::setActiveCamera(int index) {
+    if(index >= 0 && index < 3) {
+        activeCameraIndex = index;
+    }
+}
+
+void SceneRenderer::setSensorMode(bool enabled) {
+    sensorMode = enabled;
+    sensors.resetStats();
+}
+
+bool SceneRenderer::getSensorMode() const {
+    return sensorMode;
+}
+
+SensorRenderer &SceneRenderer::getSensorRenderer() {
+    return sensors;
+}
+
+// Render coordinate axes at the origin.
+void SceneRenderer::renderMarkers(Shader* shader) {
+    static unsigned int markerVAO = 0, markerVBO = 0;
+    if (markerVAO == 0) {
+        float markers[] = {
+                // X axis: from (0,0,0) to (1,0,0)
+                0.0f, 0.0f, 0.0f,
+                1.0f, 0.0f, 0.0f,
+                // Y axis: from (0,0,0) to (0,1,0)
+                0.0f, 0.0f, 0.0f,
+                0.0f, 1.0f, 0.0f,
+                // Z axis: from (0,0,0) to (0,0,1)
+                0.0f, 0.0f, 0.0f,
+                0.0f, 0.0f, 1.0f
+        };
+
+        glGenVertexArrays(1, &markerVAO);
+        glGenBuffers(1, &markerVBO);
+        glBindVertexArray(markerVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, markerVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(markers), markers, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+
+    shader->use();
+    glm::mat4 model = glm::mat4(1.0f);
+    shader->setMat4("model", model);
+
+    glBindVertexArray(markerVAO);
+
+    // Draw X axis in red.
+    shader->setVec3("objectColor", glm::vec3(1.0f, 0.0f, 0.0f));
+    glDrawArrays(GL_LINES, 0, 2);
+
+    // Draw Y axis in green.
+    shader->setVec3("objectColor", glm::vec3(0.0f, 1.0f, 0.0f));
+    glDrawArrays(GL_LINES, 2, 2);
+
+    // Draw Z axis in blue.
+    shader->setVec3("objectColor", glm::vec3(0.0f, 0.0f, 1.0f));
+    glDrawArrays(GL_LINES, 4, 2);
+
+    glBindVertexArray(0);
+}
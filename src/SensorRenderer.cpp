@@ -0,0 +1,265 @@
+#include "SensorRenderer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+// The vertex stage only places vertices in the world; the geometry stage
+// replicates each triangle into every layer with that layer's camera.
+static const char* sensorVertexSource = R"(
+    #version 400 core
+    layout (location = 0) in vec3 aPos;
+
+    uniform mat4 model;
+
+    void main(){
+        gl_Position = model * vec4(aPos, 1.0);
+    }
+    )";
+
+static const char* sensorGeometrySource = R"(
+    #version 400 core
+    layout (triangles, invocations = 32) in;
+    layout (triangle_strip, max_vertices = 3) out;
+
+    uniform mat4 viewProjection[32];
+    uniform int layerBase;
+    uniform int layerCount;
+
+    void main(){
+        if (gl_InvocationID >= layerCount)
+            return;
+        for (int i = 0; i < 3; i++) {
+            gl_Layer = layerBase + gl_InvocationID;
+            gl_Position = viewProjection[gl_InvocationID] * gl_in[i].gl_Position;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+    )";
+
+static const char* sensorFragmentSource = R"(
+    #version 400 core
+    out vec4 FragColor;
+
+    uniform vec3 objectColor;
+
+    void main(){
+        FragColor = vec4(objectColor, 1.0);
+    }
+    )";
+
+SensorRenderer::SensorRenderer(int width, int height, int maxViews, std::size_t memoryBudget, int ringSize)
+    : width(width), height(height), maxViews(std::max(maxViews, 1)), memoryBudget(memoryBudget),
+      nextWrite(0), nextRead(0), sequence(0), nextView(0),
+      colorArray(0), depthArray(0), renderFBO(0), readFBO(0), shader(nullptr),
+      statsStart(std::chrono::steady_clock::now()),
+      framesDelivered(0), bytesDelivered(0), droppedFrames(0), latencyTotal(0.0)
+{
+    ring.resize(std::max(ringSize, 2));
+    for (auto &readback : ring) {
+        readback.pbo = 0;
+        readback.fence = nullptr;
+    }
+}
+
+SensorRenderer::~SensorRenderer() {
+    // GL objects are released together with the context.
+    delete shader;
+}
+
+void SensorRenderer::setConsumer(std::function<void(const SensorFrame&)> consumer) {
+    this->consumer = std::move(consumer);
+}
+
+void SensorRenderer::initGL() {
+    if (shader)
+        return;
+    shader = new Shader(sensorVertexSource, sensorGeometrySource, sensorFragmentSource);
+
+    // Each view takes a colour and a depth layer plus its share of every readback buffer.
+    GLint layerLimit = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layerLimit);
+    std::size_t viewBytes = static_cast<std::size_t>(width) * height * (4 + 4 + 4 * ring.size());
+    int budgetViews = static_cast<int>(std::min<std::size_t>(memoryBudget / viewBytes, 1 << 30));
+    int fitting = std::max(1, std::min(budgetViews, layerLimit > 0 ? static_cast<int>(layerLimit) : maxViews));
+    if (fitting < maxViews) {
+        const char* limit = layerLimit > 0 && layerLimit < budgetViews ? "layer limit" : "memory budget";
+        std::cout << "Sensors: " << maxViews << " views exceed the " << limit << "; rendering " << fitting
+                  << " per capture in turn" << std::endl;
+        maxViews = fitting;
+    }
+
+    // Colour and depth arrays, attached layered so gl_Layer selects the target view.
+    glGenTextures(1, &colorArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, colorArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, maxViews, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &depthArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, maxViews, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &renderFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorArray, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "ERROR::SENSOR::FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+    // Separate framebuffer to read individual layers from.
+    glGenFramebuffers(1, &readFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLsizeiptr ringBytes = static_cast<GLsizeiptr>(width) * height * 4 * maxViews;
+    for (auto &readback : ring) {
+        glGenBuffers(1, &readback.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, ringBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void SensorRenderer::capture(long long tick, const std::vector<glm::mat4> &viewProjections,
+                             const std::function<void(Shader*, const glm::mat4*, int)> &drawWorld) {
+    int total = static_cast<int>(viewProjections.size());
+    if (total == 0)
+        return;
+    initGL();
+    int views = std::min(total, maxViews);
+
+    // Free up finished buffers first; if the next one is still in flight, skip this frame.
+    poll();
+    Readback &target = ring[nextWrite];
+    if (target.fence) {
+        droppedFrames++;
+        return;
+    }
+
+    // Everything fits: always start at the first view. Otherwise carry on where the last capture stopped.
+    int first = views < total ? nextView % total : 0;
+
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, renderFBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    shader->use();
+    for (int base = 0; base < views; base += MAX_VIEWS_PER_PASS) {
+        int count = std::min(MAX_VIEWS_PER_PASS, views - base);
+        passViews.resize(count);
+        for (int i = 0; i < count; i++) {
+            passViews[i] = viewProjections[(first + base + i) % total];
+            shader->setMat4("viewProjection[" + std::to_string(i) + "]", passViews[i]);
+        }
+        shader->setInt("layerBase", base);
+        shader->setInt("layerCount", count);
+        drawWorld(shader, passViews.data(), count);
+    }
+
+    // Queue the readback of every rendered layer into the pixel buffer.
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, target.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    std::size_t layerBytes = static_cast<std::size_t>(width) * height * 4;
+    for (int layer = 0; layer < views; layer++) {
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorArray, 0, layer);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)(layer * layerBytes));
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+
+    target.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    target.sequence = sequence++;
+    target.tick = tick;
+    target.layers = views;
+    target.firstView = first;
+    target.submitted = std::chrono::steady_clock::now();
+    // Make sure the fence reaches the GPU so later zero-timeout checks can see it signal.
+    glFlush();
+
+    nextWrite = (nextWrite + 1) % ring.size();
+    nextView = (first + views) % total;
+}
+
+void SensorRenderer::poll() {
+    while (ring[nextRead].fence) {
+        Readback &readback = ring[nextRead];
+        GLsync fence = static_cast<GLsync>(readback.fence);
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            return;
+        glDeleteSync(fence);
+        readback.fence = nullptr;
+
+        std::size_t bytes = static_cast<std::size_t>(width) * height * 4 * readback.layers;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+        if (pixels) {
+            SensorFrame frame;
+            frame.sequence = readback.sequence;
+            frame.tick = readback.tick;
+            frame.width = width;
+            frame.height = height;
+            frame.layers = readback.layers;
+            frame.firstView = readback.firstView;
+            frame.pixels = static_cast<const unsigned char*>(pixels);
+            frame.latencySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - readback.submitted).count();
+            if (consumer)
+                consumer(frame);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+            framesDelivered++;
+            bytesDelivered += bytes;
+            latencyTotal += frame.latencySeconds;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        nextRead = (nextRead + 1) % ring.size();
+    }
+}
+
+int SensorRenderer::getWidth() const {
+    return width;
+}
+
+int SensorRenderer::getHeight() const {
+    return height;
+}
+
+int SensorRenderer::getMaxViews() const {
+    return maxViews;
+}
+
+double SensorRenderer::getFramesPerSecond() const {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+    return seconds > 0.0 ? framesDelivered / seconds : 0.0;
+}
+
+double SensorRenderer::getMegabytesPerSecond() const {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+    return seconds > 0.0 ? bytesDelivered / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+double SensorRenderer::getAverageLatency() const {
+    return framesDelivered > 0 ? latencyTotal / framesDelivered : 0.0;
+}
+
+long long SensorRenderer::getDroppedFrames() const {
+    return droppedFrames;
+}
+
+void SensorRenderer::resetStats() {
+    statsStart = std::chrono::steady_clock::now();
+    framesDelivered = 0;
+    bytesDelivered = 0;
+    droppedFrames = 0;
+    latencyTotal = 0.0;
+}
@@ -2,35 +2,44 @@
 #include <glad/glad.h>
 #include <iostream>
 
-Shader::Shader(const char* vertexSource, const char* fragmentSource)
+// Compile one shader stage, reporting errors under the given stage name.
+static unsigned int compileStage(GLenum stage, const char* source, const char* stageName)
 {
-    // Compile vertex shader.
-    unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertexSource, nullptr);
-    glCompileShader(vertex);
+    unsigned int shader = glCreateShader(stage);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
     int success;
     char infoLog[512];
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if(!success)
     {
-        glGetShaderInfoLog(vertex, 512, nullptr, infoLog);
-        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+        std::cerr << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
+    return shader;
+}
 
-    // Compile fragment shader.
-    unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragmentSource, nullptr);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if(!success)
-    {
-        glGetShaderInfoLog(fragment, 512, nullptr, infoLog);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+Shader::Shader(const char* vertexSource, const char* fragmentSource)
+    : Shader(vertexSource, nullptr, fragmentSource)
+{
+}
+
+Shader::Shader(const char* vertexSource, const char* geometrySource, const char* fragmentSource)
+{
+    // Compile the stages.
+    unsigned int vertex = compileStage(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    unsigned int geometry = 0;
+    if(geometrySource)
+        geometry = compileStage(GL_GEOMETRY_SHADER, geometrySource, "GEOMETRY");
+    unsigned int fragment = compileStage(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
 
     // Shader program.
+    int success;
+    char infoLog[512];
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
+    if(geometry)
+        glAttachShader(ID, geometry);
     glAttachShader(ID, fragment);
     glLinkProgram(ID);
     glGetProgramiv(ID, GL_LINK_STATUS, &success);
@@ -42,6 +51,8 @@ Shader::Shader(const char* vertexSource, const char* fragmentSource)
 
     // Delete shaders
     glDeleteShader(vertex);
+    if(geometry)
+        glDeleteShader(geometry);
     glDeleteShader(fragment);
 }
 
@@ -56,3 +67,11 @@ void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
 void Shader::setVec3(const std::string &name, const glm::vec3 &vec) const {
     glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &vec[0]);
 }
+
+void Shader::setInt(const std::string &name, int value) const {
+    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+}
+
+void Shader::setFloat(const std::string &name, float value) const {
+    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+}
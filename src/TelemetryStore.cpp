@@ -0,0 +1,445 @@
+#include "TelemetryStore.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#ifdef _WIN32
+// Keep windows.h from defining min and max macros, which break std::min and std::max.
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// File layout: this header, then blocks back to back.
+struct TelemetryFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t blockRows;
+    uint32_t reserved;
+};
+static const uint32_t TELEMETRY_FILE_MAGIC = 0x31535444;  // "DTS1"
+static const uint32_t TELEMETRY_BLOCK_MAGIC = 0x4b4c4254; // "TBLK"
+static const uint32_t TELEMETRY_VERSION = 1;
+
+// Rows are buffered for at least this many rows, and then to the end of the
+// tick, before being sorted and cut into blocks.
+static const std::size_t TELEMETRY_WINDOW_ROWS = 16 * TELEMETRY_BLOCK_ROWS;
+// A block is closed at the first change of drone once it has this many rows.
+static const uint32_t TELEMETRY_MIN_BLOCK_ROWS = 256;
+
+// Column order within a block.
+enum TelemetryColumn {
+    COLUMN_TIME,
+    COLUMN_DRONE,
+    COLUMN_POSITION_X,
+    COLUMN_POSITION_Y,
+    COLUMN_POSITION_Z,
+    COLUMN_ROTATION_X,
+    COLUMN_ROTATION_Y,
+    COLUMN_ROTATION_Z,
+    COLUMN_COUNT
+};
+
+// Every column starts on an 8-byte boundary.
+static std::size_t align8(std::size_t bytes) {
+    return (bytes + 7) & ~static_cast<std::size_t>(7);
+}
+
+static std::size_t columnBytes(int column, uint32_t rows) {
+    return align8(static_cast<std::size_t>(rows) * (column == COLUMN_TIME ? sizeof(double) : sizeof(float)));
+}
+
+std::size_t TelemetryReader::columnOffset(int column, uint32_t rows) {
+    std::size_t offset = 0;
+    for (int c = 0; c < column; c++)
+        offset += columnBytes(c, rows);
+    return offset;
+}
+
+std::size_t TelemetryReader::blockBytes(uint32_t rows) {
+    return columnOffset(COLUMN_COUNT, rows);
+}
+
+TelemetryWriter::TelemetryWriter() : rowsWritten(0) {
+}
+
+TelemetryWriter::~TelemetryWriter() {
+    close();
+}
+
+bool TelemetryWriter::open(const std::string &path) {
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    TelemetryFileHeader header;
+    header.magic = TELEMETRY_FILE_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.blockRows = TELEMETRY_BLOCK_ROWS;
+    header.reserved = 0;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    rowsWritten = 0;
+    return static_cast<bool>(file);
+}
+
+bool TelemetryWriter::isOpen() const {
+    return file.is_open();
+}
+
+void TelemetryWriter::append(double time, uint32_t drone, const glm::vec3 &position, const glm::vec3 &rotation) {
+    if (!file.is_open())
+        return;
+    // Close the window between ticks only, so it holds every drone's rows for the same stretch of time.
+    if (times.size() >= TELEMETRY_WINDOW_ROWS && time != times.back())
+        flushWindow();
+    times.push_back(time);
+    droneIndices.push_back(drone);
+    columns[0].push_back(position.x);
+    columns[1].push_back(position.y);
+    columns[2].push_back(position.z);
+    columns[3].push_back(rotation.x);
+    columns[4].push_back(rotation.y);
+    columns[5].push_back(rotation.z);
+}
+
+void TelemetryWriter::flushWindow() {
+    std::size_t count = times.size();
+    if (count == 0)
+        return;
+
+    // Group the rows by drone, in time order within each drone, and cut
+    // blocks where the drone changes. A small fleet gets one block per drone
+    // per window and a large one a few neighbouring drones per block, so the
+    // drone range, position box and pitch range of a block are tight enough
+    // for queries to skip it.
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return droneIndices[a] < droneIndices[b];
+    });
+
+    std::size_t start = 0;
+    for (std::size_t i = 1; i <= count; i++) {
+        uint32_t rows = static_cast<uint32_t>(i - start);
+        bool droneChanges = i == count || droneIndices[order[i]] != droneIndices[order[i - 1]];
+        if (rows == TELEMETRY_BLOCK_ROWS || (droneChanges && rows >= TELEMETRY_MIN_BLOCK_ROWS) || i == count) {
+            writeBlock(order.data() + start, rows);
+            start = i;
+        }
+    }
+    file.flush();
+
+    rowsWritten += static_cast<long long>(count);
+    times.clear();
+    droneIndices.clear();
+    for (auto &column : columns)
+        column.clear();
+}
+
+void TelemetryWriter::writeBlock(const uint32_t* rowOrder, uint32_t rows) {
+    // Gather the block's rows out of the window.
+    blockTimes.resize(rows);
+    blockDrones.resize(rows);
+    for (uint32_t r = 0; r < rows; r++) {
+        blockTimes[r] = times[rowOrder[r]];
+        blockDrones[r] = droneIndices[rowOrder[r]];
+    }
+    for (int c = 0; c < 6; c++) {
+        blockColumns[c].resize(rows);
+        for (uint32_t r = 0; r < rows; r++)
+            blockColumns[c][r] = columns[c][rowOrder[r]];
+    }
+
+    // Summarise the block for the sparse index.
+    TelemetryReader::BlockHeader header;
+    header.magic = TELEMETRY_BLOCK_MAGIC;
+    header.rows = rows;
+    header.minTime = *std::min_element(blockTimes.begin(), blockTimes.end());
+    header.maxTime = *std::max_element(blockTimes.begin(), blockTimes.end());
+    header.minDrone = blockDrones.front();
+    header.maxDrone = blockDrones.back();
+    for (int c = 0; c < 3; c++) {
+        header.minPosition[c] = *std::min_element(blockColumns[c].begin(), blockColumns[c].end());
+        header.maxPosition[c] = *std::max_element(blockColumns[c].begin(), blockColumns[c].end());
+        header.minRotation[c] = *std::min_element(blockColumns[c + 3].begin(), blockColumns[c + 3].end());
+        header.maxRotation[c] = *std::max_element(blockColumns[c + 3].begin(), blockColumns[c + 3].end());
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    static const char padding[8] = {0};
+    auto writeColumn = [&](const void* values, std::size_t bytes, int column) {
+        file.write(static_cast<const char*>(values), bytes);
+        file.write(padding, columnBytes(column, rows) - bytes);
+    };
+    writeColumn(blockTimes.data(), rows * sizeof(double), COLUMN_TIME);
+    writeColumn(blockDrones.data(), rows * sizeof(uint32_t), COLUMN_DRONE);
+    for (int c = 0; c < 6; c++)
+        writeColumn(blockColumns[c].data(), rows * sizeof(float), COLUMN_POSITION_X + c);
+}
+
+void TelemetryWriter::close() {
+    if (!file.is_open())
+        return;
+    flushWindow();
+    file.close();
+}
+
+long long TelemetryWriter::getRowsWritten() const {
+    return rowsWritten + static_cast<long long>(times.size());
+}
+
+static_assert(sizeof(TelemetryFileHeader) % 8 == 0, "Blocks must start 8-byte aligned");
+
+TelemetryReader::TelemetryReader() : data(nullptr), size(0),
+#ifdef _WIN32
+                                     fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr),
+#else
+                                     fileDescriptor(-1),
+#endif
+                                     rowCount(0), droneCount(0) {
+    static_assert(sizeof(BlockHeader) % 8 == 0, "Columns must start 8-byte aligned");
+}
+
+TelemetryReader::~TelemetryReader() {
+    close();
+}
+
+bool TelemetryReader::open(const std::string &path) {
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(TelemetryFileHeader))) {
+        close();
+        return false;
+    }
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+    data = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        close();
+        return false;
+    }
+#else
+    fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+        return false;
+    struct stat info;
+    if (fstat(fileDescriptor, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(TelemetryFileHeader))) {
+        close();
+        return false;
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    data = static_cast<const unsigned char*>(mapping);
+#endif
+
+    TelemetryFileHeader fileHeader;
+    std::memcpy(&fileHeader, data, sizeof(fileHeader));
+    if (fileHeader.magic != TELEMETRY_FILE_MAGIC || fileHeader.version != TELEMETRY_VERSION) {
+        close();
+        return false;
+    }
+
+    // Walk the block headers; only they are paged in.
+    std::size_t offset = sizeof(fileHeader);
+    while (offset + sizeof(BlockHeader) <= size) {
+        Block block;
+        std::memcpy(&block.header, data + offset, sizeof(BlockHeader));
+        if (block.header.magic != TELEMETRY_BLOCK_MAGIC || block.header.rows == 0)
+            break;
+        block.offset = offset + sizeof(BlockHeader);
+        if (block.offset + blockBytes(block.header.rows) > size)
+            break;
+        blocks.push_back(block);
+        rowCount += block.header.rows;
+        droneCount = std::max(droneCount, block.header.maxDrone + 1);
+        offset = block.offset + blockBytes(block.header.rows);
+    }
+    return true;
+}
+
+void TelemetryReader::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        munmap(const_cast<unsigned char*>(data), size);
+    if (fileDescriptor >= 0)
+        ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    data = nullptr;
+    size = 0;
+    blocks.clear();
+    rowCount = 0;
+    droneCount = 0;
+}
+
+int TelemetryReader::getBlockCount() const {
+    return static_cast<int>(blocks.size());
+}
+
+long long TelemetryReader::getRowCount() const {
+    return rowCount;
+}
+
+double TelemetryReader::getMinTime() const {
+    double minTime = DBL_MAX;
+    for (auto &block : blocks)
+        minTime = std::min(minTime, block.header.minTime);
+    return blocks.empty() ? 0.0 : minTime;
+}
+
+double TelemetryReader::getMaxTime() const {
+    double maxTime = -DBL_MAX;
+    for (auto &block : blocks)
+        maxTime = std::max(maxTime, block.header.maxTime);
+    return blocks.empty() ? 0.0 : maxTime;
+}
+
+template <typename T>
+const T* TelemetryReader::column(const Block &block, int index, TelemetryQueryStats &stats) const {
+    stats.bytesRead += static_cast<std::size_t>(block.header.rows) * sizeof(T);
+    return reinterpret_cast<const T*>(data + block.offset + columnOffset(index, block.header.rows));
+}
+
+static void resetStats(TelemetryQueryStats &stats, int blocksTotal) {
+    stats.blocksTotal = blocksTotal;
+    stats.blocksScanned = 0;
+    stats.rowsScanned = 0;
+    stats.rowsReturned = 0;
+    stats.bytesRead = 0;
+}
+
+std::vector<ProximityResult> TelemetryReader::findNear(const glm::vec3 &point, float radius, double t1, double t2,
+                                                       TelemetryQueryStats &stats) const {
+    resetStats(stats, getBlockCount());
+    std::vector<ProximityResult> perDrone(droneCount);
+    for (uint32_t d = 0; d < droneCount; d++)
+        perDrone[d] = {d, 0.0, 0.0, FLT_MAX, 0};
+
+    float radiusSquared = radius * radius;
+    for (auto &block : blocks) {
+        const BlockHeader &h = block.header;
+        if (h.maxTime < t1 || h.minTime > t2)
+            continue;
+        // Distance from the point to the block's bounding box.
+        glm::vec3 boxMin(h.minPosition[0], h.minPosition[1], h.minPosition[2]);
+        glm::vec3 boxMax(h.maxPosition[0], h.maxPosition[1], h.maxPosition[2]);
+        glm::vec3 nearest = glm::clamp(point, boxMin, boxMax);
+        if (glm::dot(nearest - point, nearest - point) > radiusSquared)
+            continue;
+
+        stats.blocksScanned++;
+        stats.rowsScanned += h.rows;
+        const double* times = column<double>(block, COLUMN_TIME, stats);
+        const uint32_t* drones = column<uint32_t>(block, COLUMN_DRONE, stats);
+        const float* xs = column<float>(block, COLUMN_POSITION_X, stats);
+        const float* ys = column<float>(block, COLUMN_POSITION_Y, stats);
+        const float* zs = column<float>(block, COLUMN_POSITION_Z, stats);
+        for (uint32_t r = 0; r < h.rows; r++) {
+            float dx = xs[r] - point.x, dy = ys[r] - point.y, dz = zs[r] - point.z;
+            float distanceSquared = dx * dx + dy * dy + dz * dz;
+            if (distanceSquared > radiusSquared || times[r] < t1 || times[r] > t2)
+                continue;
+            ProximityResult &result = perDrone[drones[r]];
+            if (result.rows == 0 || times[r] < result.firstTime)
+                result.firstTime = times[r];
+            if (result.rows == 0 || times[r] > result.lastTime)
+                result.lastTime = times[r];
+            result.closestDistance = std::min(result.closestDistance, distanceSquared);
+            result.rows++;
+            stats.rowsReturned++;
+        }
+    }
+
+    std::vector<ProximityResult> results;
+    for (auto &result : perDrone) {
+        if (result.rows == 0)
+            continue;
+        result.closestDistance = std::sqrt(result.closestDistance);
+        results.push_back(result);
+    }
+    return results;
+}
+
+std::vector<PitchResult> TelemetryReader::findMaxPitch(double t1, double t2, TelemetryQueryStats &stats) const {
+    resetStats(stats, getBlockCount());
+    std::vector<PitchResult> perDrone(droneCount);
+    std::vector<bool> found(droneCount, false);
+    for (uint32_t d = 0; d < droneCount; d++)
+        perDrone[d] = {d, -FLT_MAX, 0.0};
+
+    // Visit the blocks with the highest pitch first. A block can then be
+    // skipped as soon as every drone it covers already has a pitch at least
+    // as high as the block's maximum.
+    std::vector<const Block*> candidates;
+    for (auto &block : blocks) {
+        if (block.header.maxTime >= t1 && block.header.minTime <= t2)
+            candidates.push_back(&block);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Block* a, const Block* b) {
+        return a->header.maxRotation[0] > b->header.maxRotation[0];
+    });
+
+    for (const Block* block : candidates) {
+        const BlockHeader &h = block->header;
+        bool canImprove = false;
+        for (uint32_t d = h.minDrone; d <= h.maxDrone && !canImprove; d++)
+            canImprove = !found[d] || perDrone[d].maxPitch < h.maxRotation[0];
+        if (!canImprove)
+            continue;
+
+        stats.blocksScanned++;
+        stats.rowsScanned += h.rows;
+        const double* times = column<double>(*block, COLUMN_TIME, stats);
+        const uint32_t* drones = column<uint32_t>(*block, COLUMN_DRONE, stats);
+        const float* pitches = column<float>(*block, COLUMN_ROTATION_X, stats);
+        for (uint32_t r = 0; r < h.rows; r++) {
+            if (times[r] < t1 || times[r] > t2)
+                continue;
+            PitchResult &result = perDrone[drones[r]];
+            if (!found[drones[r]] || pitches[r] > result.maxPitch) {
+                result.maxPitch = pitches[r];
+                result.time = times[r];
+                found[drones[r]] = true;
+            }
+        }
+    }
+
+    std::vector<PitchResult> results;
+    for (uint32_t d = 0; d < droneCount; d++) {
+        if (found[d])
+            results.push_back(perDrone[d]);
+    }
+    stats.rowsReturned = static_cast<long long>(results.size());
+    return results;
+}
@@ -0,0 +1,276 @@
+#include "Terrain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+// Without NOMINMAX, windows.h defines min and max macros that break the clamps below.
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// File layout: this header, then the tiles row by row along x, each a
+// TILE_SAMPLES x TILE_SAMPLES block of heights quantised between the two
+// limits in the header.
+struct TerrainFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t tilesX;
+    uint32_t tilesZ;
+    uint32_t tileSamples;
+    float spacing;
+    float minHeight;
+    float maxHeight;
+};
+static const uint32_t TERRAIN_FILE_MAGIC = 0x31525444; // "DTR1"
+static const uint32_t TERRAIN_VERSION = 1;
+
+static_assert(sizeof(TerrainFileHeader) % sizeof(uint16_t) == 0, "Heights must start aligned");
+
+// Generated maps: heights span 0 to this many metres.
+static const float GENERATED_MAX_HEIGHT = 160.0f;
+// Wavelength of the broadest hills and of the ridges, in metres.
+static const float HILL_WAVELENGTH = 900.0f;
+static const float RIDGE_WAVELENGTH = 400.0f;
+static const int NOISE_OCTAVES = 6;
+
+static uint32_t hashLattice(int x, int z, uint32_t seed) {
+    uint32_t h = static_cast<uint32_t>(x) * 0x8da6b343u ^ static_cast<uint32_t>(z) * 0xd8163841u ^ seed * 0xcb1ab31fu;
+    h ^= h >> 13;
+    h *= 0x85ebca6bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// Smoothly interpolated lattice noise in [0, 1].
+static float valueNoise(float x, float z, uint32_t seed) {
+    float fx = std::floor(x), fz = std::floor(z);
+    int ix = static_cast<int>(fx), iz = static_cast<int>(fz);
+    float tx = x - fx, tz = z - fz;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    tz = tz * tz * (3.0f - 2.0f * tz);
+    auto corner = [&](int dx, int dz) { return (hashLattice(ix + dx, iz + dz, seed) & 0xffffff) / 16777215.0f; };
+    float bottom = corner(0, 0) + (corner(1, 0) - corner(0, 0)) * tx;
+    float top = corner(0, 1) + (corner(1, 1) - corner(0, 1)) * tx;
+    return bottom + (top - bottom) * tz;
+}
+
+// Rolling hills with sharper ridges on top, as a fraction of the full height.
+static float generatedHeight(float x, float z, uint32_t seed) {
+    float hills = 0.0f, ridges = 0.0f, weight = 0.0f;
+    float amplitude = 1.0f, frequency = 1.0f;
+    for (int i = 0; i < NOISE_OCTAVES; i++) {
+        hills += amplitude * valueNoise(x * frequency / HILL_WAVELENGTH, z * frequency / HILL_WAVELENGTH, seed + i);
+        float ridge = 1.0f - std::fabs(2.0f * valueNoise(x * frequency / RIDGE_WAVELENGTH, z * frequency / RIDGE_WAVELENGTH,
+                                                          seed + 100 + i) - 1.0f);
+        ridges += amplitude * ridge * ridge;
+        weight += amplitude;
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    hills /= weight;
+    ridges /= weight;
+    return std::min(std::max(0.65f * hills + 0.35f * ridges * hills * 1.6f, 0.0f), 1.0f);
+}
+
+TerrainMap::TerrainMap() : data(nullptr), size(0),
+#ifdef _WIN32
+                           fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr),
+#else
+                           fileDescriptor(-1),
+#endif
+                           heights(nullptr), tilesX(0), tilesZ(0), spacing(1.0f), minHeight(0.0f), heightStep(0.0f),
+                           origin(0.0f) {
+}
+
+TerrainMap::~TerrainMap() {
+    close();
+}
+
+bool TerrainMap::generate(const std::string &path, int tilesX, int tilesZ, float spacing, uint32_t seed) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || tilesX <= 0 || tilesZ <= 0)
+        return false;
+
+    TerrainFileHeader header;
+    header.magic = TERRAIN_FILE_MAGIC;
+    header.version = TERRAIN_VERSION;
+    header.tilesX = static_cast<uint32_t>(tilesX);
+    header.tilesZ = static_cast<uint32_t>(tilesZ);
+    header.tileSamples = TILE_SAMPLES;
+    header.spacing = spacing;
+    header.minHeight = 0.0f;
+    header.maxHeight = GENERATED_MAX_HEIGHT;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Samples on a shared tile edge come from the same world position, so neighbouring tiles agree there.
+    glm::vec2 mapOrigin = glm::vec2(static_cast<float>(tilesX), static_cast<float>(tilesZ)) * (-0.5f * TILE_QUADS * spacing);
+    std::vector<uint16_t> tile(TILE_SAMPLES * TILE_SAMPLES);
+    for (int tileZ = 0; tileZ < tilesZ; tileZ++) {
+        for (int tileX = 0; tileX < tilesX; tileX++) {
+            for (int j = 0; j < TILE_SAMPLES; j++) {
+                for (int i = 0; i < TILE_SAMPLES; i++) {
+                    float x = mapOrigin.x + (tileX * TILE_QUADS + i) * spacing;
+                    float z = mapOrigin.y + (tileZ * TILE_QUADS + j) * spacing;
+                    tile[j * TILE_SAMPLES + i] = static_cast<uint16_t>(std::lround(generatedHeight(x, z, seed) * 65535.0f));
+                }
+            }
+            file.write(reinterpret_cast<const char*>(tile.data()), tile.size() * sizeof(uint16_t));
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+bool TerrainMap::open(const std::string &path) {
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(TerrainFileHeader))) {
+        close();
+        return false;
+    }
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+    data = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        close();
+        return false;
+    }
+#else
+    fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+        return false;
+    struct stat info;
+    if (fstat(fileDescriptor, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(TerrainFileHeader))) {
+        close();
+        return false;
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    data = static_cast<const unsigned char*>(mapping);
+#endif
+
+    TerrainFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    std::size_t tileBytes = TILE_SAMPLES * TILE_SAMPLES * sizeof(uint16_t);
+    if (header.magic != TERRAIN_FILE_MAGIC || header.version != TERRAIN_VERSION || header.tileSamples != TILE_SAMPLES ||
+        header.tilesX == 0 || header.tilesZ == 0 || !(header.spacing > 0.0f) ||
+        sizeof(header) + static_cast<std::size_t>(header.tilesX) * header.tilesZ * tileBytes > size) {
+        close();
+        return false;
+    }
+
+    heights = reinterpret_cast<const uint16_t*>(data + sizeof(header));
+    tilesX = static_cast<int>(header.tilesX);
+    tilesZ = static_cast<int>(header.tilesZ);
+    spacing = header.spacing;
+    minHeight = header.minHeight;
+    heightStep = (header.maxHeight - header.minHeight) / 65535.0f;
+    origin = glm::vec2(static_cast<float>(tilesX), static_cast<float>(tilesZ)) * (-0.5f * getTileSize());
+    return true;
+}
+
+void TerrainMap::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        munmap(const_cast<unsigned char*>(data), size);
+    if (fileDescriptor >= 0)
+        ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    data = nullptr;
+    size = 0;
+    heights = nullptr;
+    tilesX = tilesZ = 0;
+}
+
+bool TerrainMap::isOpen() const {
+    return heights != nullptr;
+}
+
+int TerrainMap::getTilesX() const {
+    return tilesX;
+}
+
+int TerrainMap::getTilesZ() const {
+    return tilesZ;
+}
+
+float TerrainMap::getSpacing() const {
+    return spacing;
+}
+
+float TerrainMap::getTileSize() const {
+    return TILE_QUADS * spacing;
+}
+
+glm::vec3 TerrainMap::getMin() const {
+    return glm::vec3(origin.x, minHeight, origin.y);
+}
+
+glm::vec3 TerrainMap::getMax() const {
+    return glm::vec3(origin.x + tilesX * getTileSize(), minHeight + heightStep * 65535.0f, origin.y + tilesZ * getTileSize());
+}
+
+glm::vec2 TerrainMap::getTileOrigin(int tileX, int tileZ) const {
+    return origin + glm::vec2(static_cast<float>(tileX), static_cast<float>(tileZ)) * getTileSize();
+}
+
+float TerrainMap::getSampleHeight(int sampleX, int sampleZ) const {
+    sampleX = std::min(std::max(sampleX, 0), tilesX * TILE_QUADS);
+    sampleZ = std::min(std::max(sampleZ, 0), tilesZ * TILE_QUADS);
+    // The last sample of a row belongs to the last tile; any other shared edge sample is read from the later tile.
+    int tileX = std::min(sampleX / TILE_QUADS, tilesX - 1);
+    int tileZ = std::min(sampleZ / TILE_QUADS, tilesZ - 1);
+    const uint16_t* tile = heights + (static_cast<std::size_t>(tileZ) * tilesX + tileX) * TILE_SAMPLES * TILE_SAMPLES;
+    return minHeight + heightStep * tile[(sampleZ - tileZ * TILE_QUADS) * TILE_SAMPLES + (sampleX - tileX * TILE_QUADS)];
+}
+
+float TerrainMap::heightAt(float x, float z) const {
+    if (!heights)
+        return 0.0f;
+    float gx = std::min(std::max((x - origin.x) / spacing, 0.0f), static_cast<float>(tilesX * TILE_QUADS));
+    float gz = std::min(std::max((z - origin.y) / spacing, 0.0f), static_cast<float>(tilesZ * TILE_QUADS));
+    int sx = std::min(static_cast<int>(gx), tilesX * TILE_QUADS - 1);
+    int sz = std::min(static_cast<int>(gz), tilesZ * TILE_QUADS - 1);
+    float tx = gx - sx, tz = gz - sz;
+    // Split each quad into the same two triangles as the mesh, so drones rest on the drawn surface.
+    float h00 = getSampleHeight(sx, sz), h11 = getSampleHeight(sx + 1, sz + 1);
+    if (tx >= tz)
+        return h00 + (getSampleHeight(sx + 1, sz) - h00) * tx + (h11 - getSampleHeight(sx + 1, sz)) * tz;
+    return h00 + (getSampleHeight(sx, sz + 1) - h00) * tz + (h11 - getSampleHeight(sx, sz + 1)) * tx;
+}
+
+std::size_t TerrainMap::getFileSize() const {
+    return size;
+}
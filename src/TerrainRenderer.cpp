@@ -0,0 +1,329 @@
+#include "TerrainRenderer.h"
+#include "Profiler.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+// Tiles closer than this many metres are drawn at full detail; every
+// doubling of the distance beyond it drops one level.
+static const float LOD_BASE_DISTANCE = 150.0f;
+// Finished meshes uploaded per frame, so a burst of new tiles is spread over
+// several frames instead of stalling one.
+static const int UPLOADS_PER_FRAME = 4;
+// Meshes queued or being built at once; the nearest missing tiles go first.
+static const int MAX_PENDING_BUILDS = 32;
+static const int BUILD_THREADS = 2;
+// How far the skirts hang below the tile edges, in metres.
+static const float SKIRT_DEPTH = 8.0f;
+// Position and normal.
+static const int FLOATS_PER_VERTEX = 6;
+
+static const char* terrainVertexSource = R"(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    layout (location = 1) in vec3 aNormal;
+
+    uniform mat4 view;
+    uniform mat4 projection;
+    uniform vec3 cameraPosition;
+
+    out vec3 normal;
+    out float height;
+    out float distance;
+
+    void main(){
+        normal = aNormal;
+        height = aPos.y;
+        distance = length(aPos - cameraPosition);
+        gl_Position = projection * view * vec4(aPos, 1.0);
+    }
+    )";
+
+static const char* terrainFragmentSource = R"(
+    #version 330 core
+    in vec3 normal;
+    in float height;
+    in float distance;
+    out vec4 FragColor;
+
+    uniform float maxHeight;
+    uniform float fogDistance;
+
+    void main(){
+        vec3 n = normalize(normal);
+        float slope = 1.0 - n.y;
+        // Grass, rock on steep slopes, snow on the high flat parts.
+        vec3 color = mix(vec3(0.3, 0.55, 0.25), vec3(0.45, 0.42, 0.38), smoothstep(0.2, 0.45, slope));
+        color = mix(color, vec3(0.9, 0.9, 0.92), smoothstep(0.75, 0.9, height / maxHeight) * (1.0 - smoothstep(0.3, 0.5, slope)));
+        float light = 0.35 + 0.65 * max(dot(n, normalize(vec3(0.4, 1.0, 0.3))), 0.0);
+        // Fade into the clear colour towards the edge of the streamed area, so tiles do not pop in.
+        float fog = smoothstep(0.6 * fogDistance, fogDistance, distance);
+        FragColor = vec4(mix(color * light, vec3(0.1), fog), 1.0);
+    }
+    )";
+
+// Vertices per side of a tile mesh at a level.
+static int levelSide(int level) {
+    return TerrainMap::TILE_QUADS / (1 << level) + 1;
+}
+
+TerrainRenderer::TerrainRenderer(const TerrainMap &map, std::size_t memoryBudget)
+    : map(map), memoryBudget(memoryBudget), cachedBytes(0), frame(0), evictions(0), shader(nullptr),
+      drawnTiles(0), uploads(0), builders(BUILD_THREADS) {
+    for (int level = 0; level < LOD_LEVELS; level++) {
+        indexBuffers[level] = 0;
+        indexCounts[level] = 0;
+    }
+}
+
+TerrainRenderer::~TerrainRenderer() {
+    // GL objects are released together with the context; the builders are joined when they go out of scope.
+    delete shader;
+}
+
+uint64_t TerrainRenderer::makeKey(int tileX, int tileZ, int level) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(tileZ)) << 32) |
+           (static_cast<uint64_t>(static_cast<uint32_t>(tileX)) << 4) | static_cast<uint64_t>(level);
+}
+
+void TerrainRenderer::initGL() {
+    if (shader)
+        return;
+    shader = new Shader(terrainVertexSource, terrainFragmentSource);
+
+    // Two triangles per quad, split along the same diagonal as TerrainMap::heightAt,
+    // then a strip of two triangles per edge segment down to the skirt.
+    for (int level = 0; level < LOD_LEVELS; level++) {
+        int n = levelSide(level);
+        std::vector<uint16_t> indices;
+        for (int j = 0; j + 1 < n; j++) {
+            for (int i = 0; i + 1 < n; i++) {
+                uint16_t v00 = static_cast<uint16_t>(j * n + i), v10 = v00 + 1;
+                uint16_t v01 = static_cast<uint16_t>(v00 + n), v11 = v01 + 1;
+                indices.insert(indices.end(), {v00, v10, v11, v00, v11, v01});
+            }
+        }
+        for (int edge = 0; edge < 4; edge++) {
+            for (int k = 0; k + 1 < n; k++) {
+                auto gridVertex = [&](int at) {
+                    int i = edge == 2 ? 0 : edge == 3 ? n - 1 : at;
+                    int j = edge == 0 ? 0 : edge == 1 ? n - 1 : at;
+                    return static_cast<uint16_t>(j * n + i);
+                };
+                uint16_t g0 = gridVertex(k), g1 = gridVertex(k + 1);
+                uint16_t s0 = static_cast<uint16_t>(n * n + edge * n + k), s1 = s0 + 1;
+                indices.insert(indices.end(), {g0, g1, s1, g0, s1, s0});
+            }
+        }
+        glGenBuffers(1, &indexBuffers[level]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffers[level]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+        indexCounts[level] = static_cast<int>(indices.size());
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void TerrainRenderer::collectWanted(const glm::vec3 &cameraPosition) {
+    wanted.clear();
+    wantedKeys.clear();
+    float tileSize = map.getTileSize();
+    glm::vec3 mapMin = map.getMin();
+    int reach = static_cast<int>(std::ceil(VIEW_DISTANCE / tileSize));
+    int centreX = static_cast<int>(std::floor((cameraPosition.x - mapMin.x) / tileSize));
+    int centreZ = static_cast<int>(std::floor((cameraPosition.z - mapMin.z) / tileSize));
+    for (int tileZ = std::max(centreZ - reach, 0); tileZ <= std::min(centreZ + reach, map.getTilesZ() - 1); tileZ++) {
+        for (int tileX = std::max(centreX - reach, 0); tileX <= std::min(centreX + reach, map.getTilesX() - 1); tileX++) {
+            // Distance in the ground plane to the nearest point of the tile.
+            glm::vec2 lo = map.getTileOrigin(tileX, tileZ);
+            float dx = std::max(std::max(lo.x - cameraPosition.x, cameraPosition.x - (lo.x + tileSize)), 0.0f);
+            float dz = std::max(std::max(lo.y - cameraPosition.z, cameraPosition.z - (lo.y + tileSize)), 0.0f);
+            float distance = std::sqrt(dx * dx + dz * dz);
+            if (distance > VIEW_DISTANCE)
+                continue;
+            int level = distance < LOD_BASE_DISTANCE ? 0 : static_cast<int>(std::log2(distance / LOD_BASE_DISTANCE)) + 1;
+            level = std::min(level, LOD_LEVELS - 1);
+            wanted.push_back({tileX, tileZ, level, distance});
+            wantedKeys.insert(makeKey(tileX, tileZ, level));
+        }
+    }
+    std::sort(wanted.begin(), wanted.end(),
+              [](const WantedTile &a, const WantedTile &b) { return a.distance < b.distance; });
+}
+
+void TerrainRenderer::uploadFinished() {
+    if (uploading.empty()) {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        uploading.swap(finished);
+    }
+
+    uploads = 0;
+    while (!uploading.empty() && uploads < UPLOADS_PER_FRAME) {
+        BuiltTile built = std::move(uploading.back());
+        uploading.pop_back();
+        building.erase(built.key);
+        // The camera may have moved on while it was being built.
+        if (!wantedKeys.count(built.key) || cache.count(built.key))
+            continue;
+
+        CachedTile tile;
+        tile.level = static_cast<int>(built.key & 0xf);
+        tile.bytes = built.vertices.size() * sizeof(float);
+        tile.lastFrame = frame;
+        glGenVertexArrays(1, &tile.vao);
+        glGenBuffers(1, &tile.vbo);
+        glBindVertexArray(tile.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, tile.vbo);
+        glBufferData(GL_ARRAY_BUFFER, tile.bytes, built.vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffers[tile.level]);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        recentlyUsed.push_front(built.key);
+        tile.recent = recentlyUsed.begin();
+        cache.emplace(built.key, tile);
+        cachedBytes += tile.bytes;
+        uploads++;
+    }
+}
+
+void TerrainRenderer::requestBuild(int tileX, int tileZ, int level) {
+    uint64_t key = makeKey(tileX, tileZ, level);
+    if (building.count(key) || static_cast<int>(building.size()) >= MAX_PENDING_BUILDS)
+        return;
+    building.insert(key);
+    builders.submit([this, tileX, tileZ, level, key]() {
+        BuiltTile built;
+        built.key = key;
+        buildMesh(tileX, tileZ, level, built.vertices);
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished.push_back(std::move(built));
+    });
+}
+
+TerrainRenderer::CachedTile* TerrainRenderer::findDrawable(int tileX, int tileZ, int level) {
+    CachedTile* found = nullptr;
+    for (int offset = 0; offset < LOD_LEVELS && !found; offset++) {
+        for (int candidate : {level + offset, level - offset}) {
+            if (candidate < 0 || candidate >= LOD_LEVELS)
+                continue;
+            auto it = cache.find(makeKey(tileX, tileZ, candidate));
+            if (it != cache.end()) {
+                found = &it->second;
+                break;
+            }
+        }
+    }
+    if (found) {
+        found->lastFrame = frame;
+        recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, found->recent);
+    }
+    return found;
+}
+
+void TerrainRenderer::evict() {
+    while (cachedBytes > memoryBudget && !recentlyUsed.empty()) {
+        auto it = cache.find(recentlyUsed.back());
+        // Everything left was drawn this frame; allow the overshoot until the view moves on.
+        if (it->second.lastFrame == frame)
+            break;
+        glDeleteVertexArrays(1, &it->second.vao);
+        glDeleteBuffers(1, &it->second.vbo);
+        cachedBytes -= it->second.bytes;
+        cache.erase(it);
+        recentlyUsed.pop_back();
+        evictions++;
+    }
+}
+
+void TerrainRenderer::render(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition) {
+    PROFILE_ZONE("TerrainRenderer::render");
+    initGL();
+    frame++;
+
+    collectWanted(cameraPosition);
+    uploadFinished();
+
+    shader->use();
+    shader->setMat4("view", view);
+    shader->setMat4("projection", projection);
+    shader->setVec3("cameraPosition", cameraPosition);
+    shader->setFloat("maxHeight", map.getMax().y);
+    shader->setFloat("fogDistance", VIEW_DISTANCE);
+
+    drawnTiles = 0;
+    for (auto &tile : wanted) {
+        if (!cache.count(makeKey(tile.tileX, tile.tileZ, tile.level)))
+            requestBuild(tile.tileX, tile.tileZ, tile.level);
+        CachedTile* cached = findDrawable(tile.tileX, tile.tileZ, tile.level);
+        if (!cached)
+            continue;
+        glBindVertexArray(cached->vao);
+        glDrawElements(GL_TRIANGLES, indexCounts[cached->level], GL_UNSIGNED_SHORT, (void*)0);
+        drawnTiles++;
+    }
+    glBindVertexArray(0);
+
+    evict();
+}
+
+void TerrainRenderer::buildMesh(int tileX, int tileZ, int level, std::vector<float> &vertices) const {
+    int step = 1 << level;
+    int n = levelSide(level);
+    float spacing = map.getSpacing();
+    glm::vec2 origin = map.getTileOrigin(tileX, tileZ);
+    int firstX = tileX * TerrainMap::TILE_QUADS, firstZ = tileZ * TerrainMap::TILE_QUADS;
+
+    vertices.clear();
+    vertices.reserve(static_cast<std::size_t>(n * n + 4 * n) * FLOATS_PER_VERTEX);
+    auto addVertex = [&](int i, int j, float drop) {
+        int sx = firstX + i * step, sz = firstZ + j * step;
+        float height = map.getSampleHeight(sx, sz);
+        // Central differences over the level's spacing, reaching into the neighbouring tiles at the edges.
+        glm::vec3 normal = glm::normalize(glm::vec3(map.getSampleHeight(sx - step, sz) - map.getSampleHeight(sx + step, sz),
+                                                    2.0f * step * spacing,
+                                                    map.getSampleHeight(sx, sz - step) - map.getSampleHeight(sx, sz + step)));
+        vertices.insert(vertices.end(), {origin.x + i * step * spacing, height - drop, origin.y + j * step * spacing,
+                                         normal.x, normal.y, normal.z});
+    };
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++)
+            addVertex(i, j, 0.0f);
+    }
+    // Skirts, in the edge order the index buffers expect: near z, far z, near x, far x.
+    for (int k = 0; k < n; k++)
+        addVertex(k, 0, SKIRT_DEPTH);
+    for (int k = 0; k < n; k++)
+        addVertex(k, n - 1, SKIRT_DEPTH);
+    for (int k = 0; k < n; k++)
+        addVertex(0, k, SKIRT_DEPTH);
+    for (int k = 0; k < n; k++)
+        addVertex(n - 1, k, SKIRT_DEPTH);
+}
+
+int TerrainRenderer::getDrawnTiles() const {
+    return drawnTiles;
+}
+
+int TerrainRenderer::getUploads() const {
+    return uploads;
+}
+
+int TerrainRenderer::getPendingBuilds() const {
+    return static_cast<int>(building.size());
+}
+
+int TerrainRenderer::getCachedTiles() const {
+    return static_cast<int>(cache.size());
+}
+
+std::size_t TerrainRenderer::getMemoryUsage() const {
+    return cachedBytes;
+}
+
+long long TerrainRenderer::getEvictions() const {
+    return evictions;
+}
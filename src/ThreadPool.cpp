@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(int threadCount) : threadCount(threadCount), stopping(false) {
+    if (this->threadCount <= 0)
+        this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (auto &thread : threads)
+        thread.join();
+}
+
+void ThreadPool::start() {
+    // Called with the mutex held.
+    if (!threads.empty())
+        return;
+    for (int i = 0; i < threadCount; i++)
+        threads.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+void ThreadPool::workerLoop() {
+    PROFILE_THREAD("worker");
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        PROFILE_ZONE("ThreadPool::job");
+        job();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        start();
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int, int)> &fn) {
+    if (count <= 0)
+        return;
+
+    // A few chunks per thread so uneven chunks still balance out.
+    int chunkSize = std::max(1, count / (threadCount * 4));
+    int chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 1 || threadCount == 1) {
+        fn(0, count);
+        return;
+    }
+
+    std::atomic<int> nextChunk(0);
+    auto runChunks = [&]() {
+        for (int chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+            int begin = chunk * chunkSize;
+            fn(begin, std::min(begin + chunkSize, count));
+        }
+    };
+
+    // Helpers reference this stack frame, so wait for all of them to finish,
+    // not merely for the chunks to run out.
+    int helperCount = std::min(threadCount, chunkCount) - 1;
+    int helpersDone = 0;
+    std::mutex doneMutex;
+    std::condition_variable doneSignal;
+    for (int i = 0; i < helperCount; i++) {
+        submit([&]() {
+            runChunks();
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (++helpersDone == helperCount)
+                doneSignal.notify_one();
+        });
+    }
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneSignal.wait(lock, [&] { return helpersDone == helperCount; });
+}
+
+int ThreadPool::getThreadCount() const {
+    return threadCount;
+}
@@ -0,0 +1,166 @@
+#include "TrailRenderer.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+// The vertex shader walks each drone's ring backwards from the newest slot,
+// so wraparound is resolved per vertex and the buffer is never compacted.
+static const char* trailVertexSource = R"(
+    #version 330 core
+    uniform samplerBuffer history;
+    uniform int capacity;
+    uniform int rowStride;
+    uniform int newestSlot;
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    out float age;
+
+    void main(){
+        int drone = gl_VertexID / capacity;
+        int back = gl_VertexID - drone * capacity;
+        int slot = (newestSlot - back + capacity) % capacity;
+        vec3 position = texelFetch(history, slot * rowStride + drone).xyz;
+        age = float(back) / float(capacity);
+        gl_Position = projection * view * vec4(position, 1.0);
+    }
+    )";
+
+static const char* trailFragmentSource = R"(
+    #version 330 core
+    in float age;
+    out vec4 FragColor;
+
+    void main(){
+        // Fade from bright cyan at the drone to dark blue at the tail.
+        FragColor = vec4(mix(vec3(0.2, 1.0, 1.0), vec3(0.05, 0.1, 0.3), age), 1.0);
+    }
+    )";
+
+TrailRenderer::TrailRenderer(int maxDrones, float seconds, float sampleInterval, std::size_t memoryBudget)
+    : maxDrones(std::max(maxDrones, 1)), capacity(2), activeDrones(0),
+      rowsAppended(0), rowsUploaded(0),
+      historyBuffer(0), historyTexture(0), emptyVAO(0), shader(nullptr)
+{
+    // Samples needed to cover the requested history, bounded by the memory budget.
+    std::size_t rowBytes = this->maxDrones * sizeof(glm::vec3);
+    std::size_t wanted = static_cast<std::size_t>(seconds / sampleInterval) + 1;
+    std::size_t affordable = memoryBudget / rowBytes;
+    capacity = static_cast<int>(std::max<std::size_t>(std::min(wanted, affordable), 2));
+
+    validSamples.assign(this->maxDrones, 0);
+    drawFirsts.reserve(this->maxDrones);
+    drawCounts.reserve(this->maxDrones);
+}
+
+TrailRenderer::~TrailRenderer() {
+    // GL objects are released together with the context.
+    delete shader;
+}
+
+void TrailRenderer::append(const std::vector<glm::vec3> &positions) {
+    activeDrones = std::min(static_cast<int>(positions.size()), maxDrones);
+
+    // If nothing has been uploaded for a whole ring, drop the older half of
+    // the pending rows at once to keep this amortised. Only the rows still
+    // pending are contiguous with the newest sample, so trails are cut there.
+    long long pending = rowsAppended - rowsUploaded;
+    if (pending >= capacity) {
+        long long drop = pending / 2;
+        pendingRows.erase(pendingRows.begin(), pendingRows.begin() + drop * maxDrones);
+        rowsUploaded += drop;
+        int kept = static_cast<int>(pending - drop);
+        for (int &valid : validSamples)
+            valid = std::min(valid, kept);
+    }
+
+    pendingRows.insert(pendingRows.end(), positions.begin(), positions.begin() + activeDrones);
+    pendingRows.resize(pendingRows.size() + (maxDrones - activeDrones), glm::vec3(0.0f));
+    rowsAppended++;
+
+    for (int i = 0; i < activeDrones; i++) {
+        if (validSamples[i] < capacity)
+            validSamples[i]++;
+    }
+}
+
+void TrailRenderer::clear(int droneIndex) {
+    if (droneIndex >= 0 && droneIndex < maxDrones)
+        validSamples[droneIndex] = 0;
+}
+
+int TrailRenderer::getCapacity() const {
+    return capacity;
+}
+
+void TrailRenderer::initGL() {
+    if (shader)
+        return;
+    shader = new Shader(trailVertexSource, trailFragmentSource);
+
+    glGenBuffers(1, &historyBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, historyBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(capacity) * maxDrones * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenTextures(1, &historyTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, historyTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, historyBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Vertices are fetched from the texture buffer, but core profile still needs a VAO bound.
+    glGenVertexArrays(1, &emptyVAO);
+}
+
+void TrailRenderer::uploadPending() {
+    long long pending = rowsAppended - rowsUploaded;
+    if (pending <= 0)
+        return;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, historyBuffer);
+    std::size_t rowBytes = maxDrones * sizeof(glm::vec3);
+    long long done = 0;
+    while (done < pending) {
+        // Rows are contiguous up to the end of the ring, so this loops at most twice.
+        int slot = static_cast<int>((rowsUploaded + done) % capacity);
+        long long count = std::min<long long>(pending - done, capacity - slot);
+        glBufferSubData(GL_TEXTURE_BUFFER, slot * rowBytes, count * rowBytes, &pendingRows[done * maxDrones]);
+        done += count;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    pendingRows.clear();
+    rowsUploaded = rowsAppended;
+}
+
+void TrailRenderer::render(const glm::mat4 &view, const glm::mat4 &projection) {
+    if (rowsAppended == 0)
+        return;
+    initGL();
+    uploadPending();
+
+    drawFirsts.clear();
+    drawCounts.clear();
+    for (int i = 0; i < activeDrones; i++) {
+        if (validSamples[i] < 2)
+            continue;
+        drawFirsts.push_back(i * capacity);
+        drawCounts.push_back(validSamples[i]);
+    }
+    if (drawFirsts.empty())
+        return;
+
+    shader->use();
+    shader->setMat4("view", view);
+    shader->setMat4("projection", projection);
+    shader->setInt("capacity", capacity);
+    shader->setInt("rowStride", maxDrones);
+    shader->setInt("newestSlot", static_cast<int>((rowsAppended - 1) % capacity));
+    shader->setInt("history", 0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, historyTexture);
+    glBindVertexArray(emptyVAO);
+    glMultiDrawArrays(GL_LINE_STRIP, drawFirsts.data(), drawCounts.data(), static_cast<GLsizei>(drawFirsts.size()));
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
@@ -0,0 +1,427 @@
+#include "Trajectory.h"
+#include <algorithm>
+#include <cmath>
+
+// Steps per segment used to measure its arc length when it is added.
+static const int ARC_MEASURE_STEPS = 64;
+
+// Three-point Gauss-Legendre quadrature on [0, 1], for arc lengths.
+static const int GAUSS_POINTS = 3;
+static const float GAUSS_NODES[GAUSS_POINTS] = {0.11270167f, 0.5f, 0.88729833f};
+static const float GAUSS_WEIGHTS[GAUSS_POINTS] = {0.27777778f, 0.44444444f, 0.27777778f};
+
+// Table intervals whose Hermite lookup is off the true speed by more than
+// this fraction at any of ARC_SPEED_CHECKS - 1 inner points get a Newton step.
+static const float ARC_SPEED_TOLERANCE = 0.001f;
+static const int ARC_SPEED_CHECKS = 8;
+
+// Waypoints closer together than this are merged.
+static const float MIN_WAYPOINT_SPACING = 1e-3f;
+
+// Released segments are only compacted away once there are at least this many.
+static const int COMPACT_MIN_SEGMENTS = 1024;
+
+TrajectoryEngine::TrajectoryEngine() : releasedSegments(0) {
+}
+
+int TrajectoryEngine::addPath(const std::vector<glm::vec3> &waypoints, bool closed) {
+    std::vector<glm::vec3> points;
+    for (auto &point : waypoints) {
+        if (points.empty() || glm::length(point - points.back()) > MIN_WAYPOINT_SPACING)
+            points.push_back(point);
+    }
+    if (closed && points.size() > 2 && glm::length(points.front() - points.back()) <= MIN_WAYPOINT_SPACING)
+        points.pop_back();
+    int count = static_cast<int>(points.size());
+    if (count < 2)
+        return -1;
+    if (releasedSegments >= COMPACT_MIN_SEGMENTS && releasedSegments * 2 > static_cast<int>(segmentLengths.size()))
+        compact();
+
+    Path path;
+    path.firstSegment = static_cast<int>(segmentLengths.size());
+    path.segmentCount = closed ? count : count - 1;
+    path.closed = closed;
+    path.length = 0.0f;
+
+    // Neighbours of the end points of an open path are mirrored so its first
+    // and last segments start and end heading straight at their neighbours.
+    auto point = [&](int i) -> glm::vec3 {
+        if (closed)
+            return points[(i + count) % count];
+        if (i < 0)
+            return 2.0f * points[0] - points[1];
+        if (i >= count)
+            return 2.0f * points[count - 1] - points[count - 2];
+        return points[i];
+    };
+    for (int i = 0; i < path.segmentCount; i++) {
+        addSegment(point(i - 1), point(i), point(i + 1), point(i + 2));
+        path.length += segmentLengths.back();
+    }
+    if (!freePaths.empty()) {
+        int id = freePaths.back();
+        freePaths.pop_back();
+        paths[id] = path;
+        return id;
+    }
+    paths.push_back(path);
+    return static_cast<int>(paths.size()) - 1;
+}
+
+// Centripetal Catmull-Rom segment from p1 to p2, converted to one cubic per
+// axis over u in [0, 1] through its Hermite form.
+void TrajectoryEngine::addSegment(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3) {
+    float t01 = std::sqrt(std::max(glm::length(p1 - p0), MIN_WAYPOINT_SPACING));
+    float t12 = std::sqrt(std::max(glm::length(p2 - p1), MIN_WAYPOINT_SPACING));
+    float t23 = std::sqrt(std::max(glm::length(p3 - p2), MIN_WAYPOINT_SPACING));
+    glm::vec3 m1 = ((p1 - p0) / t01 - (p2 - p0) / (t01 + t12) + (p2 - p1) / t12) * t12;
+    glm::vec3 m2 = ((p2 - p1) / t12 - (p3 - p1) / (t12 + t23) + (p3 - p2) / t23) * t12;
+
+    glm::vec3 a = 2.0f * p1 - 2.0f * p2 + m1 + m2;
+    glm::vec3 b = -3.0f * p1 + 3.0f * p2 - 2.0f * m1 - m2;
+    glm::vec3 c = m1;
+    glm::vec3 d = p1;
+    for (int axis = 0; axis < 3; axis++) {
+        coefficients.push_back(a[axis]);
+        coefficients.push_back(b[axis]);
+        coefficients.push_back(c[axis]);
+        coefficients.push_back(d[axis]);
+    }
+
+    // Measure the cumulative length at fine steps, then invert it at evenly spaced lengths.
+    auto speedAt = [&](float u) { return glm::length((3.0f * a * u + 2.0f * b) * u + c); };
+    auto lengthBetween = [&](float from, float to) {
+        float length = 0.0f;
+        for (int g = 0; g < GAUSS_POINTS; g++)
+            length += GAUSS_WEIGHTS[g] * speedAt(from + (to - from) * GAUSS_NODES[g]);
+        return length * (to - from);
+    };
+    float measured[ARC_MEASURE_STEPS + 1];
+    measured[0] = 0.0f;
+    for (int i = 1; i <= ARC_MEASURE_STEPS; i++)
+        measured[i] = measured[i - 1] + lengthBetween(static_cast<float>(i - 1) / ARC_MEASURE_STEPS,
+                                                      static_cast<float>(i) / ARC_MEASURE_STEPS);
+    float length = std::max(measured[ARC_MEASURE_STEPS], MIN_WAYPOINT_SPACING);
+    segmentLengths.push_back(length);
+
+    std::size_t tableStart = arcTable.size();
+    int step = 0;
+    for (int j = 0; j < ARC_TABLE_SIZE; j++) {
+        float target = length * j / ARC_SAMPLES;
+        while (step < ARC_MEASURE_STEPS - 1 && measured[step + 1] < target)
+            step++;
+        float span = measured[step + 1] - measured[step];
+        float fraction = span > 0.0f ? std::min(std::max((target - measured[step]) / span, 0.0f), 1.0f) : 0.0f;
+        float u = (step + fraction) / ARC_MEASURE_STEPS;
+        // Linear interpolation only gets close; Newton steps put the sample at its exact arc length.
+        float stepStart = static_cast<float>(step) / ARC_MEASURE_STEPS;
+        for (int k = 0; k < 2; k++) {
+            float error = measured[step] + lengthBetween(stepStart, u) - target;
+            u -= error / std::max(speedAt(u), MIN_WAYPOINT_SPACING);
+        }
+        // The slope du/ds, scaled to one table interval, makes the lookup a
+        // cubic Hermite curve that matches the speed along the path at every sample.
+        float slope = length / ARC_SAMPLES / std::max(speedAt(u), MIN_WAYPOINT_SPACING);
+        arcTable.push_back(u);
+        arcTable.push_back(slope);
+    }
+
+    // Between samples the Hermite curve can still be off where the spline's
+    // own speed changes quickly, such as in tight turns; flag those intervals.
+    float interval = length / ARC_SAMPLES;
+    for (int j = 0; j < ARC_SAMPLES; j++) {
+        const float* k = &arcTable[tableStart + j * 2];
+        bool correct = false;
+        for (int q = 1; q < ARC_SPEED_CHECKS && !correct; q++) {
+            float t = static_cast<float>(q) / ARC_SPEED_CHECKS, t2 = t * t, t3 = t2 * t;
+            float u = (2.0f * t3 - 3.0f * t2 + 1.0f) * k[0] + (t3 - 2.0f * t2 + t) * k[1] +
+                      (3.0f * t2 - 2.0f * t3) * k[2] + (t3 - t2) * k[3];
+            float dudt = (6.0f * t2 - 6.0f * t) * k[0] + (3.0f * t2 - 4.0f * t + 1.0f) * k[1] +
+                         (6.0f * t - 6.0f * t2) * k[2] + (3.0f * t2 - 2.0f * t) * k[3];
+            correct = std::fabs(speedAt(u) * dudt / interval - 1.0f) > ARC_SPEED_TOLERANCE;
+        }
+        arcCorrections.push_back(correct ? 1 : 0);
+    }
+}
+
+float TrajectoryEngine::getPathLength(int path) const {
+    return paths[path].length;
+}
+
+void TrajectoryEngine::releasePath(int path) {
+    if (path < 0 || path >= static_cast<int>(paths.size()) || paths[path].segmentCount == 0)
+        return;
+    releasedSegments += paths[path].segmentCount;
+    paths[path].segmentCount = 0;
+    paths[path].length = 0.0f;
+    freePaths.push_back(path);
+}
+
+// Move the segments of the live paths together and point their followers at the new place.
+void TrajectoryEngine::compact() {
+    std::vector<float> liveCoefficients, liveLengths, liveArcTable;
+    std::vector<unsigned char> liveArcCorrections;
+    std::vector<int> shift(paths.size(), 0);
+    for (size_t p = 0; p < paths.size(); p++) {
+        Path &path = paths[p];
+        if (path.segmentCount == 0)
+            continue;
+        int first = static_cast<int>(liveLengths.size());
+        shift[p] = first - path.firstSegment;
+        int end = path.firstSegment + path.segmentCount;
+        liveCoefficients.insert(liveCoefficients.end(), coefficients.begin() + path.firstSegment * COEFFICIENTS,
+                                coefficients.begin() + end * COEFFICIENTS);
+        liveLengths.insert(liveLengths.end(), segmentLengths.begin() + path.firstSegment, segmentLengths.begin() + end);
+        liveArcTable.insert(liveArcTable.end(), arcTable.begin() + path.firstSegment * ARC_TABLE_SIZE * 2,
+                            arcTable.begin() + end * ARC_TABLE_SIZE * 2);
+        liveArcCorrections.insert(liveArcCorrections.end(), arcCorrections.begin() + path.firstSegment * ARC_SAMPLES,
+                                  arcCorrections.begin() + end * ARC_SAMPLES);
+        path.firstSegment = first;
+    }
+    coefficients.swap(liveCoefficients);
+    segmentLengths.swap(liveLengths);
+    arcTable.swap(liveArcTable);
+    arcCorrections.swap(liveArcCorrections);
+    for (int f = 0; f < getFollowerCount(); f++)
+        followerSegments[f] += shift[followerPaths[f]];
+    releasedSegments = 0;
+}
+
+void TrajectoryEngine::follow(int drone, int path, float speed) {
+    if (path < 0 || path >= static_cast<int>(paths.size()) || paths[path].segmentCount == 0)
+        return;
+    if (drone >= static_cast<int>(droneFollowers.size()))
+        droneFollowers.resize(drone + 1, -1);
+
+    int follower = droneFollowers[drone];
+    if (follower < 0) {
+        follower = static_cast<int>(followerDrones.size());
+        droneFollowers[drone] = follower;
+        followerDrones.push_back(drone);
+        followerPaths.push_back(0);
+        followerSegments.push_back(0);
+        followerDistances.push_back(0.0f);
+        followerSpeeds.push_back(0.0f);
+    }
+    followerPaths[follower] = path;
+    followerSegments[follower] = paths[path].firstSegment;
+    followerDistances[follower] = 0.0f;
+    followerSpeeds[follower] = speed;
+}
+
+void TrajectoryEngine::stop(int drone) {
+    if (isFollowing(drone))
+        removeFollower(droneFollowers[drone]);
+}
+
+bool TrajectoryEngine::isFollowing(int drone) const {
+    return drone < static_cast<int>(droneFollowers.size()) && droneFollowers[drone] >= 0;
+}
+
+void TrajectoryEngine::clear() {
+    paths.clear();
+    freePaths.clear();
+    releasedSegments = 0;
+    coefficients.clear();
+    segmentLengths.clear();
+    arcTable.clear();
+    arcCorrections.clear();
+    followerDrones.clear();
+    followerPaths.clear();
+    followerSegments.clear();
+    followerDistances.clear();
+    followerSpeeds.clear();
+    droneFollowers.clear();
+}
+
+void TrajectoryEngine::removeDrone(int drone, int last) {
+    stop(drone);
+    if (last != drone && isFollowing(last)) {
+        int follower = droneFollowers[last];
+        followerDrones[follower] = drone;
+        droneFollowers[drone] = follower;
+        droneFollowers[last] = -1;
+    }
+}
+
+// Swap-remove, like Scene::removeDrone.
+void TrajectoryEngine::removeFollower(int follower) {
+    int last = static_cast<int>(followerDrones.size()) - 1;
+    droneFollowers[followerDrones[follower]] = -1;
+    if (follower != last) {
+        followerDrones[follower] = followerDrones[last];
+        followerPaths[follower] = followerPaths[last];
+        followerSegments[follower] = followerSegments[last];
+        followerDistances[follower] = followerDistances[last];
+        followerSpeeds[follower] = followerSpeeds[last];
+        droneFollowers[followerDrones[follower]] = follower;
+    }
+    followerDrones.pop_back();
+    followerPaths.pop_back();
+    followerSegments.pop_back();
+    followerDistances.pop_back();
+    followerSpeeds.pop_back();
+}
+
+void TrajectoryEngine::advance(float deltaTime) {
+    int count = getFollowerCount();
+    for (int f = 0; f < count; f++) {
+        // Most ticks stay within the segment; the loop only runs on a segment change.
+        float distance = followerDistances[f] + followerSpeeds[f] * deltaTime;
+        int segment = followerSegments[f];
+        while (distance >= segmentLengths[segment]) {
+            const Path &path = paths[followerPaths[f]];
+            int end = path.firstSegment + path.segmentCount;
+            if (segment + 1 < end) {
+                distance -= segmentLengths[segment];
+                segment++;
+            } else if (path.closed) {
+                distance -= segmentLengths[segment];
+                segment = path.firstSegment;
+            } else {
+                distance = segmentLengths[segment];
+                break;
+            }
+        }
+        followerSegments[f] = segment;
+        followerDistances[f] = distance;
+    }
+
+    positionsX.resize(count);
+    positionsY.resize(count);
+    positionsZ.resize(count);
+    directionsX.resize(count);
+    directionsY.resize(count);
+    directionsZ.resize(count);
+    for (int first = 0; first < count; first += TRAJECTORY_BATCH_SIZE)
+        evaluateBatch(first);
+}
+
+void TrajectoryEngine::evaluateBatch(int first) {
+    const int N = TRAJECTORY_BATCH_SIZE;
+    int last = getFollowerCount() - 1;
+
+    // Gather each lane's coefficients and look up its spline parameter; a
+    // short final batch repeats its last follower.
+    float coefficient[COEFFICIENTS][N];
+    float arc[4][N], t[N], u[N], covered[N];
+    bool correct = false;
+    for (int l = 0; l < N; l++) {
+        int f = std::min(first + l, last);
+        int segment = followerSegments[f];
+        const float* c = &coefficients[segment * COEFFICIENTS];
+        for (int k = 0; k < COEFFICIENTS; k++)
+            coefficient[k][l] = c[k];
+
+        float sample = followerDistances[f] / segmentLengths[segment] * ARC_SAMPLES;
+        int index = std::min(static_cast<int>(sample), ARC_SAMPLES - 1);
+        const float* table = &arcTable[(segment * ARC_TABLE_SIZE + index) * 2];
+        for (int k = 0; k < 4; k++)
+            arc[k][l] = table[k];
+        t[l] = sample - index;
+        // Arc length to cover from the table sample.
+        covered[l] = t[l] * segmentLengths[segment] / ARC_SAMPLES;
+        correct = correct || arcCorrections[segment * ARC_SAMPLES + index];
+    }
+
+    // Spline parameter from the Hermite curve between the two table samples.
+    for (int l = 0; l < N; l++) {
+        float t2 = t[l] * t[l], t3 = t2 * t[l];
+        u[l] = (2.0f * t3 - 3.0f * t2 + 1.0f) * arc[0][l] + (t3 - 2.0f * t2 + t[l]) * arc[1][l] +
+               (3.0f * t2 - 2.0f * t3) * arc[2][l] + (t3 - t2) * arc[3][l];
+    }
+
+    // Speed along the spline, |dp/du|, of every lane at the given parameters.
+    auto speedAt = [&](const float* at, float* speed) {
+        for (int l = 0; l < N; l++)
+            speed[l] = 0.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            const float* a = coefficient[axis * 4];
+            const float* b = coefficient[axis * 4 + 1];
+            const float* c = coefficient[axis * 4 + 2];
+            for (int l = 0; l < N; l++) {
+                float d = (3.0f * a[l] * at[l] + 2.0f * b[l]) * at[l] + c[l];
+                speed[l] += d * d;
+            }
+        }
+        for (int l = 0; l < N; l++)
+            speed[l] = std::sqrt(speed[l]);
+    };
+
+    // In flagged intervals, one Newton step on the arc length from the table
+    // sample, measured by Gauss-Legendre quadrature. The whole batch takes it.
+    if (correct) {
+        float node[N], speed[N], error[N];
+        for (int l = 0; l < N; l++)
+            error[l] = -covered[l];
+        for (int g = 0; g < GAUSS_POINTS; g++) {
+            for (int l = 0; l < N; l++)
+                node[l] = arc[0][l] + (u[l] - arc[0][l]) * GAUSS_NODES[g];
+            speedAt(node, speed);
+            for (int l = 0; l < N; l++)
+                error[l] += GAUSS_WEIGHTS[g] * (u[l] - arc[0][l]) * speed[l];
+        }
+        speedAt(u, speed);
+        for (int l = 0; l < N; l++)
+            u[l] -= error[l] / std::max(speed[l], MIN_WAYPOINT_SPACING);
+    }
+
+    // Position and tangent by Horner's rule, one axis at a time.
+    float position[3][N], tangent[3][N];
+    for (int axis = 0; axis < 3; axis++) {
+        const float* a = coefficient[axis * 4];
+        const float* b = coefficient[axis * 4 + 1];
+        const float* c = coefficient[axis * 4 + 2];
+        const float* d = coefficient[axis * 4 + 3];
+        for (int l = 0; l < N; l++) {
+            position[axis][l] = ((a[l] * u[l] + b[l]) * u[l] + c[l]) * u[l] + d[l];
+            tangent[axis][l] = (3.0f * a[l] * u[l] + 2.0f * b[l]) * u[l] + c[l];
+        }
+    }
+    float inverseLength[N];
+    for (int l = 0; l < N; l++) {
+        float lengthSquared = tangent[0][l] * tangent[0][l] + tangent[1][l] * tangent[1][l] + tangent[2][l] * tangent[2][l];
+        inverseLength[l] = 1.0f / std::sqrt(std::max(lengthSquared, 1e-12f));
+    }
+
+    int lanes = std::min(N, last + 1 - first);
+    for (int l = 0; l < lanes; l++) {
+        positionsX[first + l] = position[0][l];
+        positionsY[first + l] = position[1][l];
+        positionsZ[first + l] = position[2][l];
+        directionsX[first + l] = tangent[0][l] * inverseLength[l];
+        directionsY[first + l] = tangent[1][l] * inverseLength[l];
+        directionsZ[first + l] = tangent[2][l] * inverseLength[l];
+    }
+}
+
+int TrajectoryEngine::getFollowerCount() const {
+    return static_cast<int>(followerDrones.size());
+}
+
+int TrajectoryEngine::getFollowerDrone(int follower) const {
+    return followerDrones[follower];
+}
+
+glm::vec3 TrajectoryEngine::getPosition(int follower) const {
+    return glm::vec3(positionsX[follower], positionsY[follower], positionsZ[follower]);
+}
+
+glm::vec3 TrajectoryEngine::getDirection(int follower) const {
+    return glm::vec3(directionsX[follower], directionsY[follower], directionsZ[follower]);
+}
+
+glm::vec3 TrajectoryEngine::getRotation(int follower) const {
+    // Inverse of Drone::getFront().
+    float pitch = glm::degrees(std::asin(std::min(std::max(directionsY[follower], -1.0f), 1.0f)));
+    float yaw = glm::degrees(std::atan2(-directionsX[follower], -directionsZ[follower]));
+    return glm::vec3(pitch, yaw, 0.0f);
+}
+
+std::size_t TrajectoryEngine::getMemoryUsage() const {
+    // Per follower: drone, path, segment, distance and speed, plus the six evaluated floats.
+    std::size_t followers = followerDrones.size() * (5 + 6) * sizeof(float);
+    return paths.size() * sizeof(Path) + (coefficients.size() + segmentLengths.size() + arcTable.size()) * sizeof(float) +
+           arcCorrections.size() + followers + droneFollowers.size() * sizeof(int);
+}
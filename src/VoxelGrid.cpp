@@ -0,0 +1,96 @@
+#include "VoxelGrid.h"
+#include <algorithm>
+#include <cmath>
+
+VoxelGrid::VoxelGrid(const glm::vec3 &min, const glm::vec3 &max, float cellSize)
+    : origin(min), cellSize(cellSize), version(0) {
+    glm::vec3 size = (max - min) / cellSize;
+    sizeX = std::max(1, static_cast<int>(std::ceil(size.x)));
+    sizeY = std::max(1, static_cast<int>(std::ceil(size.y)));
+    sizeZ = std::max(1, static_cast<int>(std::ceil(size.z)));
+    cells.assign(static_cast<std::size_t>(sizeX) * sizeY * sizeZ, FREE);
+}
+
+void VoxelGrid::addObstacles(const std::vector<Aabb> &boxes, float inflate) {
+    for (auto &box : boxes) {
+        glm::vec3 lo = (box.min - glm::vec3(inflate) - origin) / cellSize - glm::vec3(0.5f);
+        glm::vec3 hi = (box.max + glm::vec3(inflate) - origin) / cellSize - glm::vec3(0.5f);
+        // Cells whose centre lies within the inflated box.
+        int x0 = std::max(0, static_cast<int>(std::ceil(lo.x))), x1 = std::min(sizeX - 1, static_cast<int>(std::floor(hi.x)));
+        int y0 = std::max(0, static_cast<int>(std::ceil(lo.y))), y1 = std::min(sizeY - 1, static_cast<int>(std::floor(hi.y)));
+        int z0 = std::max(0, static_cast<int>(std::ceil(lo.z))), z1 = std::min(sizeZ - 1, static_cast<int>(std::floor(hi.z)));
+        for (int y = y0; y <= y1; y++) {
+            for (int z = z0; z <= z1; z++) {
+                for (int x = x0; x <= x1; x++)
+                    cells[(static_cast<std::size_t>(y) * sizeZ + z) * sizeX + x] = OBSTACLE;
+            }
+        }
+    }
+}
+
+void VoxelGrid::addDrones(const std::vector<glm::vec3> &positions) {
+    for (auto &position : positions) {
+        int cell = cellAt(position);
+        if (cells[cell] == FREE)
+            cells[cell] = DRONE;
+    }
+}
+
+void VoxelGrid::setVersion(long long version) {
+    this->version = version;
+}
+
+long long VoxelGrid::getVersion() const {
+    return version;
+}
+
+int VoxelGrid::getSizeX() const {
+    return sizeX;
+}
+
+int VoxelGrid::getSizeY() const {
+    return sizeY;
+}
+
+int VoxelGrid::getSizeZ() const {
+    return sizeZ;
+}
+
+int VoxelGrid::getCellCount() const {
+    return static_cast<int>(cells.size());
+}
+
+float VoxelGrid::getCellSize() const {
+    return cellSize;
+}
+
+int VoxelGrid::cellAt(const glm::vec3 &position) const {
+    glm::vec3 g = (position - origin) / cellSize;
+    int x = std::min(std::max(static_cast<int>(std::floor(g.x)), 0), sizeX - 1);
+    int y = std::min(std::max(static_cast<int>(std::floor(g.y)), 0), sizeY - 1);
+    int z = std::min(std::max(static_cast<int>(std::floor(g.z)), 0), sizeZ - 1);
+    return (y * sizeZ + z) * sizeX + x;
+}
+
+glm::vec3 VoxelGrid::cellCentre(int cell) const {
+    int x = cell % sizeX;
+    int z = (cell / sizeX) % sizeZ;
+    int y = cell / (sizeX * sizeZ);
+    return origin + (glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) + glm::vec3(0.5f)) * cellSize;
+}
+
+VoxelGrid::Cell VoxelGrid::get(int cell) const {
+    return static_cast<Cell>(cells[cell]);
+}
+
+const uint8_t* VoxelGrid::getCells() const {
+    return cells.data();
+}
+
+void VoxelGrid::diff(const VoxelGrid &other, std::vector<int> &changed) const {
+    changed.clear();
+    for (std::size_t i = 0; i < cells.size(); i++) {
+        if (cells[i] != other.cells[i])
+            changed.push_back(static_cast<int>(i));
+    }
+}
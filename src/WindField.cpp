@@ -0,0 +1,255 @@
+#include "WindField.h"
+#include <algorithm>
+#include <cmath>
+
+// Correlation times of the two layers, in seconds.
+static const float GUST_TIME = 4.0f;
+static const float TURBULENCE_TIME = 0.5f;
+
+// Salts keeping the noise of the two layers independent.
+static const uint32_t GUST_SALT = 0x5bd1e995u;
+static const uint32_t TURBULENCE_SALT = 0x27d4eb2fu;
+
+// Integer hash of a (stream, step, node) triple.
+static inline uint32_t hashNoise(uint32_t stream, uint32_t step, uint32_t node) {
+    uint32_t h = stream * 0x9e3779b1u ^ step * 0x85ebca77u ^ node * 0xc2b2ae3du;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// Uniform noise with zero mean and unit variance.
+static inline float unitNoise(uint32_t h) {
+    const float halfWidth = 1.7320508f; // sqrt(3)
+    return (h >> 8) * (2.0f * halfWidth / 16777216.0f) - halfWidth;
+}
+
+// 64-bit hash of a (stream, step, node) triple, enough for three 21-bit noise values.
+static inline uint64_t hashNoise3(uint32_t stream, uint32_t step, uint32_t node) {
+    uint64_t h = (static_cast<uint64_t>(stream * 0x9e3779b1u ^ step * 0x85ebca77u) << 32 | node) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+// Noise component a (0, 1 or 2) of a hashNoise3 value, like unitNoise.
+static inline float unitNoise3(uint64_t h, int a) {
+    const float halfWidth = 1.7320508f; // sqrt(3)
+    return static_cast<float>((h >> (a * 21)) & 0x1fffff) * (2.0f * halfWidth / 2097152.0f) - halfWidth;
+}
+
+// Written as a * (1 - t) + b * t so t == 0 and t == 1 return a and b exactly;
+// the copies of a node held by neighbouring bricks then stay identical.
+static inline float lerp(float a, float b, float t) {
+    return a * (1.0f - t) + b * t;
+}
+
+// One multiply cheaper, for sampling, where exact end points do not matter.
+static inline float blend(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+WindField::WindField(const glm::vec3 &min, const glm::vec3 &max, float cellSize, uint32_t seed)
+    : origin(min), cellSize(cellSize), inverseCellSize(1.0f / cellSize), meanWind(0.0f),
+      gustStrength(1.5f), turbulenceStrength(0.5f), seed(seed), steps(0) {
+    glm::vec3 cells = glm::ceil((max - min) * inverseCellSize);
+    bricksX = std::max(1, static_cast<int>(std::ceil(cells.x / BRICK_CELLS)));
+    bricksY = std::max(1, static_cast<int>(std::ceil(cells.y / BRICK_CELLS)));
+    bricksZ = std::max(1, static_cast<int>(std::ceil(cells.z / BRICK_CELLS)));
+
+    // Keep samples strictly inside the last cell so its far corners stay in the same brick.
+    const float edge = 1e-3f;
+    gridLimit = glm::vec3(bricksX * BRICK_CELLS - edge, bricksY * BRICK_CELLS - edge, bricksZ * BRICK_CELLS - edge);
+
+    gusts.assign(static_cast<size_t>(bricksX + 1) * (bricksY + 1) * (bricksZ + 1) * 3, 0.0f);
+    turbulence.assign(static_cast<size_t>(bricksX * BRICK_CELLS + 1) * (bricksY * BRICK_CELLS + 1) *
+                      (bricksZ * BRICK_CELLS + 1) * 3, 0.0f);
+    velocity.assign(static_cast<size_t>(bricksX) * bricksY * bricksZ * NODES_PER_BRICK * 3, 0.0f);
+
+    // Start both layers from their steady-state spread rather than from still air.
+    step(0.0f, gustStrength, 0.0f, turbulenceStrength);
+}
+
+void WindField::setMeanWind(const glm::vec3 &wind) {
+    meanWind = wind;
+}
+
+void WindField::setGustStrength(float strength) {
+    gustStrength = strength;
+}
+
+void WindField::setTurbulenceStrength(float strength) {
+    turbulenceStrength = strength;
+}
+
+int WindField::gustIndex(int x, int y, int z) const {
+    return ((z * (bricksY + 1) + y) * (bricksX + 1) + x) * 3;
+}
+
+void WindField::advance(float deltaTime) {
+    // Each layer is an Ornstein-Uhlenbeck process sampled exactly at the step:
+    // it decays towards zero and is kicked by noise scaled to keep its spread.
+    float gustDecay = std::exp(-deltaTime / GUST_TIME);
+    float turbulenceDecay = std::exp(-deltaTime / TURBULENCE_TIME);
+    step(gustDecay, gustStrength * std::sqrt(1.0f - gustDecay * gustDecay),
+         turbulenceDecay, turbulenceStrength * std::sqrt(1.0f - turbulenceDecay * turbulenceDecay));
+}
+
+void WindField::step(float gustDecay, float gustKick, float turbulenceDecay, float turbulenceKick) {
+    steps++;
+    uint32_t tick = static_cast<uint32_t>(steps);
+
+    for (size_t i = 0; i < gusts.size(); i++)
+        gusts[i] = gusts[i] * gustDecay + gustKick * unitNoise(hashNoise(seed ^ GUST_SALT, tick, static_cast<uint32_t>(i)));
+
+    // Turbulence is kept once per grid node; one hash gives all three components.
+    uint32_t turbulenceStream = seed ^ TURBULENCE_SALT;
+    size_t nodeCount = turbulence.size() / 3;
+    for (size_t n = 0; n < nodeCount; n++) {
+        uint64_t h = hashNoise3(turbulenceStream, tick, static_cast<uint32_t>(n));
+        for (int a = 0; a < 3; a++)
+            turbulence[n * 3 + a] = turbulence[n * 3 + a] * turbulenceDecay + turbulenceKick * unitNoise3(h, a);
+    }
+
+    const int nodesX = bricksX * BRICK_CELLS + 1;
+    const int nodesY = bricksY * BRICK_CELLS + 1;
+    const int ROW = BRICK_NODES * 3;
+    float fraction[BRICK_NODES];
+    for (int i = 0; i < BRICK_NODES; i++)
+        fraction[i] = static_cast<float>(i) / BRICK_CELLS;
+    // The mean wind repeated along a row of nodes, xyz interleaved.
+    float mean[ROW];
+    for (int i = 0; i < BRICK_NODES; i++) {
+        mean[i * 3] = meanWind.x;
+        mean[i * 3 + 1] = meanWind.y;
+        mean[i * 3 + 2] = meanWind.z;
+    }
+
+    int brick = 0;
+    for (int bz = 0; bz < bricksZ; bz++) {
+        for (int by = 0; by < bricksY; by++) {
+            for (int bx = 0; bx < bricksX; bx++, brick++) {
+                // The gusts at this brick's eight corners.
+                const float* g[8];
+                for (int c = 0; c < 8; c++)
+                    g[c] = &gusts[gustIndex(bx + (c & 1), by + ((c >> 1) & 1), bz + (c >> 2))];
+
+                // Blend the gusts over the brick one axis at a time: along its four
+                // x edges, across its two z faces, then through its depth. The lerps
+                // run in the same order for every node, so nodes shared with a
+                // neighbouring brick come out identical.
+                float edges[4][ROW];
+                for (int e = 0; e < 4; e++)
+                    for (int i = 0; i < ROW; i++)
+                        edges[e][i] = lerp(g[e * 2][i % 3], g[e * 2 + 1][i % 3], fraction[i / 3]);
+                float faces[2][BRICK_NODES][ROW];
+                for (int f = 0; f < 2; f++)
+                    for (int j = 0; j < BRICK_NODES; j++)
+                        for (int i = 0; i < ROW; i++)
+                            faces[f][j][i] = lerp(edges[f * 2][i], edges[f * 2 + 1][i], fraction[j]);
+
+                float* out = &velocity[static_cast<size_t>(brick) * NODES_PER_BRICK * 3];
+                for (int k = 0; k < BRICK_NODES; k++) {
+                    for (int j = 0; j < BRICK_NODES; j++, out += ROW) {
+                        size_t row = (static_cast<size_t>(bz * BRICK_CELLS + k) * nodesY + by * BRICK_CELLS + j) * nodesX +
+                                     bx * BRICK_CELLS;
+                        const float* turb = &turbulence[row * 3];
+                        for (int i = 0; i < ROW; i++)
+                            out[i] = mean[i] + lerp(faces[0][j][i], faces[1][j][i], fraction[k]) + turb[i];
+                    }
+                }
+            }
+        }
+    }
+}
+
+glm::vec3 WindField::sample(const glm::vec3 &position) const {
+    glm::vec3 wind;
+    sampleBatch(&position.x, &position.y, &position.z, 1, &wind.x, &wind.y, &wind.z);
+    return wind;
+}
+
+void WindField::sampleBatch(const float* x, const float* y, const float* z, int count,
+                            float* windX, float* windY, float* windZ) const {
+    const int N = WIND_BATCH_SIZE;
+    int full = count - count % N;
+    for (int i = 0; i < full; i += N)
+        sampleFullBatch(x + i, y + i, z + i, windX + i, windY + i, windZ + i);
+
+    // Pad the tail with copies of its last position.
+    int rest = count - full;
+    if (rest > 0) {
+        float px[N], py[N], pz[N], wx[N], wy[N], wz[N];
+        for (int l = 0; l < N; l++) {
+            int i = full + std::min(l, rest - 1);
+            px[l] = x[i];
+            py[l] = y[i];
+            pz[l] = z[i];
+        }
+        sampleFullBatch(px, py, pz, wx, wy, wz);
+        for (int l = 0; l < rest; l++) {
+            windX[full + l] = wx[l];
+            windY[full + l] = wy[l];
+            windZ[full + l] = wz[l];
+        }
+    }
+}
+
+void WindField::sampleFullBatch(const float* x, const float* y, const float* z,
+                                float* windX, float* windY, float* windZ) const {
+    const int N = WIND_BATCH_SIZE;
+
+    // Offsets of a cell's eight corners from its first one, in floats.
+    const int dx = 3, dy = BRICK_NODES * 3, dz = BRICK_NODES * BRICK_NODES * 3;
+    const int corners[8] = {0, dx, dy, dy + dx, dz, dz + dx, dz + dy, dz + dy + dx};
+
+    // Locate each position's cell within its brick.
+    int base[N];
+    float fx[N], fy[N], fz[N];
+    for (int l = 0; l < N; l++) {
+        float gx = std::min(std::max((x[l] - origin.x) * inverseCellSize, 0.0f), gridLimit.x);
+        float gy = std::min(std::max((y[l] - origin.y) * inverseCellSize, 0.0f), gridLimit.y);
+        float gz = std::min(std::max((z[l] - origin.z) * inverseCellSize, 0.0f), gridLimit.z);
+        int ix = static_cast<int>(gx), iy = static_cast<int>(gy), iz = static_cast<int>(gz);
+        fx[l] = gx - ix;
+        fy[l] = gy - iy;
+        fz[l] = gz - iz;
+        // Grid coordinates are clamped to be non-negative, so unsigned division is just a shift.
+        unsigned ux = ix, uy = iy, uz = iz;
+        int brick = ((uz / BRICK_CELLS) * bricksY + uy / BRICK_CELLS) * bricksX + ux / BRICK_CELLS;
+        int node = ((uz % BRICK_CELLS) * BRICK_NODES + uy % BRICK_CELLS) * BRICK_NODES + ux % BRICK_CELLS;
+        base[l] = (brick * NODES_PER_BRICK + node) * 3;
+    }
+
+    // Gather the corners; this is the only scattered access.
+    float corner[8][3][N];
+    for (int l = 0; l < N; l++) {
+        const float* v = &velocity[base[l]];
+        for (int c = 0; c < 8; c++) {
+            corner[c][0][l] = v[corners[c]];
+            corner[c][1][l] = v[corners[c] + 1];
+            corner[c][2][l] = v[corners[c] + 2];
+        }
+    }
+
+    float* out[3] = {windX, windY, windZ};
+    for (int a = 0; a < 3; a++) {
+        for (int l = 0; l < N; l++) {
+            float c00 = blend(corner[0][a][l], corner[1][a][l], fx[l]);
+            float c10 = blend(corner[2][a][l], corner[3][a][l], fx[l]);
+            float c01 = blend(corner[4][a][l], corner[5][a][l], fx[l]);
+            float c11 = blend(corner[6][a][l], corner[7][a][l], fx[l]);
+            out[a][l] = blend(blend(c00, c10, fy[l]), blend(c01, c11, fy[l]), fz[l]);
+        }
+    }
+}
+
+std::size_t WindField::getMemoryUsage() const {
+    return (gusts.size() + turbulence.size() + velocity.size()) * sizeof(float);
+}
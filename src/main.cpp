@@ -1,20 +1,43 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include "Scene.h"
+#include "SceneRenderer.h"
 #include "InputHandler.h"
 #include "Shader.h"
+#include "Profiler.h"
 
 // Window dimensions.
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// Number of drones in the fleet; drone 0 is piloted from the keyboard.
+const int NUM_DRONES = 1;
+
+// Terrain map used by --terrain when no file is given; generated if missing.
+const char* DEFAULT_TERRAIN_FILE = "terrain.dtr";
+
 // Callback for window resizing.
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    PROFILE_THREAD("main");
+
+    // Optional telemetry recording: --record <file>, and terrain: --terrain [<file>].
+    std::string recordPath;
+    std::string terrainPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--terrain")
+            terrainPath = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : DEFAULT_TERRAIN_FILE;
+    }
+
     // Initialise GLFW.
     if (!glfwInit()){
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -75,28 +98,68 @@ int main() {
     // Create shader program.
     Shader shader(vertexShaderSource, fragmentShaderSource);
 
-    // Create the scene.
-    Scene scene(SCR_WIDTH, SCR_HEIGHT);
+    // Create the scene and its renderer.
+    Scene scene(NUM_DRONES);
+    if (!terrainPath.empty() && !scene.enableTerrain(terrainPath))
+        std::cerr << "Failed to open terrain map " << terrainPath << std::endl;
+    SceneRenderer renderer(scene, SCR_WIDTH, SCR_HEIGHT);
 
     // Set up the input handler.
     glfwSetKeyCallback(window, InputHandler::keyCallback);
     InputHandler::setScene(&scene);
+    InputHandler::setRenderer(&renderer);
+
+    if (!recordPath.empty()) {
+        if (scene.startRecording(recordPath))
+            std::cout << "Recording telemetry to " << recordPath << std::endl;
+        else
+            std::cerr << "Failed to open telemetry file " << recordPath << std::endl;
+    }
+
+    // The simulation runs at a fixed rate on its own thread; this thread only renders.
+    scene.start();
+
+    double statsStart = glfwGetTime();
+    long long statsTicks = scene.getSimulatedTicks();
+    long long statsFrames = 0;
 
     // Main loop.
     while(!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        PROFILE_ZONE("frame");
+        {
+            PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
 
-        // Update scene.
-        scene.update();
-
-        // Render scene.
+        // Render the newest published state.
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        scene.render(&shader);
-
-        glfwSwapBuffers(window);
+        renderer.render(&shader);
+
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        statsFrames++;
+
+        // Show the simulation and render rates in the title bar once a second.
+        double now = glfwGetTime();
+        if (now - statsStart >= 1.0) {
+            long long ticks = scene.getSimulatedTicks();
+            std::ostringstream title;
+            title.setf(std::ios::fixed);
+            title.precision(0);
+            title << "Drone Project | sim " << (ticks - statsTicks) / (now - statsStart) << " Hz"
+                  << " | render " << statsFrames / (now - statsStart) << " FPS";
+            glfwSetWindowTitle(window, title.str().c_str());
+            statsStart = now;
+            statsTicks = ticks;
+            statsFrames = 0;
+        }
     }
 
+    scene.stop();
+    scene.stopRecording();
     glfwTerminate();
     return 0;
 }
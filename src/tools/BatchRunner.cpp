@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Scene.h"
+
+#ifdef _WIN32
+// No min/max macros, so the std::min and std::max calls below still compile.
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Runs the same flight scenario many times with perturbed initial
+// conditions and control parameters, on every core and without rendering.
+// One CSV row is appended per finished run, so an interrupted batch picks
+// up where it left off when started again with the same settings.
+
+// Every drone in the scenario flies forward each tick and turns on these intervals.
+static const int TURN_INTERVAL_TICKS = 20;
+static const int CLIMB_INTERVAL_TICKS = 45;
+
+// How often progress is printed.
+static const int REPORT_INTERVAL_SECONDS = 5;
+
+struct BatchConfig {
+    std::string resultPath;
+    int runs = 1000;
+    int threads = 0;
+    uint64_t seed = 1;
+    float seconds = 30.0f;
+    int drones = 1;
+};
+
+// Perturbed parameters of one run.
+struct RunParameters {
+    uint64_t seed;
+    float propellerSpeed;
+    float turnRate;
+    float yaw;
+    float pitch;
+    float jitter;
+};
+
+struct RunSummary {
+    long long collisions;
+    double firstCollisionTime; // -1 if none.
+    double meanPathLength;
+    double meanFinalDistance;
+    float minAltitude;
+    float maxAltitude;
+    double wallSeconds;
+};
+
+// SplitMix64: reproducible on every platform, unlike std:: distributions.
+static uint64_t splitMix64(uint64_t &state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static float uniform(uint64_t &state, float lo, float hi) {
+    return lo + (hi - lo) * static_cast<float>(splitMix64(state) >> 40) / 16777216.0f;
+}
+
+static RunParameters makeParameters(uint64_t batchSeed, int run) {
+    uint64_t state = batchSeed ^ (static_cast<uint64_t>(run) * 0xd1b54a32d192ed03ULL);
+    RunParameters parameters;
+    parameters.seed = splitMix64(state);
+    parameters.propellerSpeed = uniform(state, 60.0f, 160.0f);
+    parameters.turnRate = uniform(state, 2.0f, 8.0f);
+    parameters.yaw = uniform(state, -180.0f, 180.0f);
+    parameters.pitch = uniform(state, -10.0f, 10.0f);
+    parameters.jitter = uniform(state, 0.0f, 1.0f);
+    return parameters;
+}
+
+static RunSummary runScenario(const BatchConfig &config, const RunParameters &parameters) {
+    auto start = std::chrono::steady_clock::now();
+
+    Scene scene(config.drones, static_cast<uint32_t>(parameters.seed));
+    scene.setLidarEnabled(false);
+    scene.setHistoryEnabled(false);
+    scene.setStatsEnabled(false);
+
+    // Each drone gets its own offset from home, drawn from the run's seed.
+    uint64_t state = parameters.seed;
+    for (int i = 0; i < scene.getDroneCount(); i++) {
+        Drone* drone = scene.getDrone(i);
+        drone->setPropellerSpeed(parameters.propellerSpeed);
+        drone->setTurnRate(parameters.turnRate);
+        glm::vec3 offset(uniform(state, -1.0f, 1.0f), uniform(state, -0.5f, 0.5f), uniform(state, -1.0f, 1.0f));
+        scene.placeDrone(i, drone->getHome() + offset * parameters.jitter,
+                         glm::vec3(parameters.pitch, parameters.yaw, 0.0f));
+    }
+
+    RunSummary summary = {};
+    summary.firstCollisionTime = -1.0;
+    summary.minAltitude = 1e30f;
+    summary.maxAltitude = -1e30f;
+    std::vector<glm::vec3> previous(scene.getDroneCount());
+    std::vector<double> pathLength(scene.getDroneCount(), 0.0);
+    for (int i = 0; i < scene.getDroneCount(); i++)
+        previous[i] = scene.getDrone(i)->getPosition();
+
+    int ticks = static_cast<int>(config.seconds / Scene::TICK_SECONDS);
+    for (int t = 0; t < ticks; t++) {
+        for (int i = 0; i < scene.getDroneCount(); i++) {
+            Drone* drone = scene.getDrone(i);
+            drone->moveForward();
+            if (t % TURN_INTERVAL_TICKS == 0)
+                drone->turnLeft();
+            if (t % CLIMB_INTERVAL_TICKS == 0) {
+                if ((t / CLIMB_INTERVAL_TICKS) % 2 == 0)
+                    drone->turnUp();
+                else
+                    drone->turnDown();
+            }
+        }
+        scene.update();
+
+        if (summary.firstCollisionTime < 0.0 && scene.getCollisionCount() > 0)
+            summary.firstCollisionTime = scene.getSimTime();
+        for (int i = 0; i < scene.getDroneCount(); i++) {
+            glm::vec3 position = scene.getDrone(i)->getPosition();
+            pathLength[i] += glm::length(position - previous[i]);
+            previous[i] = position;
+            summary.minAltitude = std::min(summary.minAltitude, position.y);
+            summary.maxAltitude = std::max(summary.maxAltitude, position.y);
+        }
+    }
+
+    summary.collisions = scene.getCollisionCount();
+    for (int i = 0; i < scene.getDroneCount(); i++) {
+        summary.meanPathLength += pathLength[i] / scene.getDroneCount();
+        summary.meanFinalDistance += glm::length(previous[i] - scene.getDrone(i)->getHome()) / scene.getDroneCount();
+    }
+    summary.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+// CPU time consumed by the calling thread.
+static double threadCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    auto toSeconds = [](const FILETIME &time) {
+        return ((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+    };
+    return toSeconds(kernel) + toSeconds(user);
+#else
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+static std::string configLine(const BatchConfig &config) {
+    std::ostringstream line;
+    line << "# runs=" << config.runs << " seed=" << config.seed << " seconds=" << config.seconds
+         << " drones=" << config.drones;
+    return line.str();
+}
+
+static const char* CSV_HEADER = "run,seed,propeller_speed,turn_rate,yaw,pitch,jitter,collisions,first_collision_time,"
+                                "mean_path_length,mean_final_distance,min_altitude,max_altitude,wall_ms";
+
+// Read the runs already in the result file. Returns false if the file was
+// written with different settings, in which case it is left untouched. A row
+// cut short by an interruption is dropped from the file.
+static bool loadCompletedRuns(const BatchConfig &config, std::vector<char> &done, bool &exists) {
+    std::ifstream in(config.resultPath, std::ios::binary);
+    exists = static_cast<bool>(in);
+    if (!exists)
+        return true;
+
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::size_t complete = contents.rfind('\n');
+    complete = complete == std::string::npos ? 0 : complete + 1;
+
+    std::istringstream lines(contents.substr(0, complete));
+    std::string line;
+    bool sameConfig = false;
+    while (std::getline(lines, line)) {
+        if (line.empty())
+            continue;
+        if (line[0] == '#') {
+            sameConfig = line == configLine(config);
+            continue;
+        }
+        if (line[0] < '0' || line[0] > '9')
+            continue;
+        int run = std::atoi(line.c_str());
+        if (run >= 0 && run < config.runs)
+            done[run] = 1;
+    }
+    // A file cut short within its header can only be ours if it is the start
+    // of our own header; it is then started again from scratch.
+    std::string header = configLine(config) + "\n" + CSV_HEADER + "\n";
+    if (complete < header.size()) {
+        sameConfig = header.compare(0, contents.size(), contents) == 0;
+        complete = 0;
+    }
+    if (!sameConfig)
+        return false;
+
+    if (complete < contents.size()) {
+        std::ofstream out(config.resultPath, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), complete);
+    }
+    exists = complete > 0;
+    return true;
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <results.csv> [--runs N] [--threads N] [--seed N] [--seconds S] [--drones N]"
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    BatchConfig config;
+    config.resultPath = argv[1];
+    for (int i = 2; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (option == "--runs")
+            config.runs = std::atoi(argv[i + 1]);
+        else if (option == "--threads")
+            config.threads = std::atoi(argv[i + 1]);
+        else if (option == "--seed")
+            config.seed = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (option == "--seconds")
+            config.seconds = static_cast<float>(std::atof(argv[i + 1]));
+        else if (option == "--drones")
+            config.drones = std::max(1, std::atoi(argv[i + 1]));
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.threads <= 0)
+        config.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<char> done(config.runs, 0);
+    bool exists;
+    if (!loadCompletedRuns(config, done, exists)) {
+        std::cerr << config.resultPath << " was written with different settings; use another file." << std::endl;
+        return 1;
+    }
+    std::vector<int> pending;
+    for (int run = 0; run < config.runs; run++) {
+        if (!done[run])
+            pending.push_back(run);
+    }
+    std::cout << "Batch: " << config.runs << " runs, " << config.runs - pending.size() << " already done, "
+              << config.threads << " threads" << std::endl;
+
+    std::ofstream results(config.resultPath, std::ios::binary | std::ios::app);
+    if (!results) {
+        std::cerr << "Failed to open " << config.resultPath << std::endl;
+        return 1;
+    }
+    if (!exists)
+        results << configLine(config) << "\n" << CSV_HEADER << "\n" << std::flush;
+
+    std::mutex resultsMutex;
+    std::atomic<int> nextRun(0);
+    std::atomic<int> finishedRuns(0);
+    // CPU time of each worker, in microseconds, updated after every run.
+    std::vector<std::atomic<long long>> cpuMicros(config.threads);
+    for (auto &micros : cpuMicros)
+        micros = 0;
+
+    auto worker = [&](int index) {
+        double cpuStart = threadCpuSeconds();
+        for (int i = nextRun++; i < static_cast<int>(pending.size()); i = nextRun++) {
+            int run = pending[i];
+            RunParameters parameters = makeParameters(config.seed, run);
+            RunSummary summary = runScenario(config, parameters);
+
+            std::ostringstream row;
+            row << run << ',' << parameters.seed << ',' << parameters.propellerSpeed << ',' << parameters.turnRate << ','
+                << parameters.yaw << ',' << parameters.pitch << ',' << parameters.jitter << ',' << summary.collisions << ','
+                << summary.firstCollisionTime << ',' << summary.meanPathLength << ',' << summary.meanFinalDistance << ','
+                << summary.minAltitude << ',' << summary.maxAltitude << ',' << summary.wallSeconds * 1000.0 << '\n';
+            {
+                // One whole row per write, flushed so an interruption loses at most the runs in flight.
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                results << row.str() << std::flush;
+            }
+            finishedRuns++;
+            cpuMicros[index] = static_cast<long long>((threadCpuSeconds() - cpuStart) * 1e6);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.threads; i++)
+        threads.emplace_back(worker, i);
+
+    auto report = [&](bool final) {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        int finished = finishedRuns;
+        std::cout << (final ? "Done: " : "Progress: ") << finished << "/" << pending.size() << " runs, "
+                  << static_cast<long long>(finished / std::max(elapsed, 1e-9) * 3600.0) << " runs/hour, core utilisation";
+        double total = 0.0;
+        for (auto &micros : cpuMicros) {
+            double utilisation = micros * 1e-6 / std::max(elapsed, 1e-9);
+            total += utilisation;
+            std::cout << " " << static_cast<int>(utilisation * 100.0 + 0.5) << "%";
+        }
+        std::cout << " (mean " << static_cast<int>(total / config.threads * 100.0 + 0.5) << "%)" << std::endl;
+    };
+
+    // Report progress from the main thread until the workers finish.
+    std::mutex waitMutex;
+    std::condition_variable allDone;
+    bool workersDone = false;
+    std::thread joiner([&]() {
+        for (auto &thread : threads)
+            thread.join();
+        std::lock_guard<std::mutex> lock(waitMutex);
+        workersDone = true;
+        allDone.notify_all();
+    });
+    {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        while (!allDone.wait_for(lock, std::chrono::seconds(REPORT_INTERVAL_SECONDS), [&] { return workersDone; }))
+            report(false);
+    }
+    joiner.join();
+    report(true);
+    return 0;
+}
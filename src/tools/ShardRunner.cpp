@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Scene.h"
+#include "SpscRing.h"
+
+// Steps one swarm split across several worker processes, each owning a strip
+// of the room along x, and reports throughput for an increasing number of
+// shards. Every tick each worker steps its own drones, hands drones that
+// crossed into a neighbouring strip over to that neighbour and sends copies
+// of the drones near its borders as read-only ghosts, all through rings in
+// shared memory. A coordinator process keeps the shards in lockstep.
+//
+// POSIX only: the workers are forked and share anonymous mappings.
+
+// The room the drones fly in; strips split it along x.
+static const float ROOM_MIN = -20.0f;
+static const float ROOM_MAX = 20.0f;
+
+// Drones closer than this count as a near miss. Ghosts are sent for drones
+// within GHOST_MARGIN of a border, which must cover the near-miss distance
+// plus the distance a drone can fly in one tick.
+static const float NEAR_MISS_DISTANCE = 1.0f;
+static const float GHOST_MARGIN = 2.0f;
+
+// Drone i turns left every TURN_INTERVAL_BASE + i % TURN_INTERVAL_SPREAD ticks.
+static const int TURN_INTERVAL_BASE = 15;
+static const int TURN_INTERVAL_SPREAD = 30;
+
+static const uint32_t MIGRATION_RING_SIZE = 1024;
+static const uint32_t GHOST_RING_SIZE = 8192;
+
+static_assert(std::is_trivially_copyable<Drone>::value, "Drones are copied through shared memory");
+
+struct Migrant {
+    uint32_t id;
+    Drone drone;
+};
+
+struct Ghost {
+    uint32_t id;
+    glm::vec3 position;
+};
+
+using MigrationRing = SpscRing<Migrant, MIGRATION_RING_SIZE>;
+using GhostRing = SpscRing<Ghost, GHOST_RING_SIZE>;
+
+// Inbound rings of one shard; index 0 is fed by the left neighbour, 1 by the right one.
+struct ShardInbox {
+    MigrationRing migrations[2];
+    GhostRing ghosts[2];
+};
+
+// Written by a worker, read by the coordinator once the worker has exited.
+struct ShardStats {
+    int ownedAtEnd;
+    long long migrations;
+    long long migrationsDeferred; // Retried next tick because the neighbour's ring was full.
+    long long ghostsSent;
+    long long ghostsDropped;
+    long long nearMisses;
+    long long collisions;
+    double busySeconds; // Stepping and exchanging, excluding barrier waits.
+};
+
+struct ShardControl {
+    SpinBarrier tick;     // All workers plus the coordinator.
+    SpinBarrier exchange; // Workers only.
+
+    ShardControl(uint32_t shards) : tick(shards + 1), exchange(shards) {
+    }
+};
+
+struct ShardConfig {
+    int drones = 2000;
+    int ticks = 1000;
+    int maxShards = 8;
+    uint64_t seed = 1;
+};
+
+// SplitMix64, as in the batch runner, so every shard places the swarm identically.
+static uint64_t splitMix64(uint64_t &state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static float uniform(uint64_t &state, float lo, float hi) {
+    return lo + (hi - lo) * static_cast<float>(splitMix64(state) >> 40) / 16777216.0f;
+}
+
+static int ownerOf(float x, int shards) {
+    int shard = static_cast<int>(std::floor((x - ROOM_MIN) / (ROOM_MAX - ROOM_MIN) * shards));
+    return std::min(std::max(shard, 0), shards - 1);
+}
+
+template <typename T>
+static T* mapShared(std::size_t count) {
+    void* memory = mmap(nullptr, sizeof(T) * count, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? nullptr : static_cast<T*>(memory);
+}
+
+template <typename T>
+static void unmapShared(T* memory, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++)
+        memory[i].~T();
+    munmap(memory, sizeof(T) * count);
+}
+
+// Count near misses between owned drones and everything the shard can see,
+// using a grid of NEAR_MISS_DISTANCE cells sorted by cell. A pair is counted
+// by the owner of the drone with the lower id, so no pair is counted twice
+// across shards.
+static long long countNearMisses(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &ids, int owned,
+                                 std::vector<std::pair<uint32_t, int>> &cells) {
+    auto cellOf = [](const glm::vec3 &p, int dx, int dy, int dz) -> uint32_t {
+        uint32_t x = static_cast<uint32_t>(std::floor((p.x - ROOM_MIN) / NEAR_MISS_DISTANCE) + 1 + dx);
+        uint32_t y = static_cast<uint32_t>(std::floor(p.y / NEAR_MISS_DISTANCE) + 1 + dy);
+        uint32_t z = static_cast<uint32_t>(std::floor((p.z - ROOM_MIN) / NEAR_MISS_DISTANCE) + 1 + dz);
+        return (x * 64 + y) * 64 + z;
+    };
+
+    cells.clear();
+    for (int i = 0; i < static_cast<int>(positions.size()); i++)
+        cells.push_back({cellOf(positions[i], 0, 0, 0), i});
+    std::sort(cells.begin(), cells.end());
+
+    long long nearMisses = 0;
+    float limit = NEAR_MISS_DISTANCE * NEAR_MISS_DISTANCE;
+    for (int i = 0; i < owned; i++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dz = -1; dz <= 1; dz++) {
+                    uint32_t cell = cellOf(positions[i], dx, dy, dz);
+                    auto it = std::lower_bound(cells.begin(), cells.end(), std::make_pair(cell, 0));
+                    for (; it != cells.end() && it->first == cell; ++it) {
+                        int j = it->second;
+                        glm::vec3 d = positions[j] - positions[i];
+                        if (ids[i] < ids[j] && glm::dot(d, d) < limit)
+                            nearMisses++;
+                    }
+                }
+            }
+        }
+    }
+    return nearMisses;
+}
+
+static void runShard(const ShardConfig &config, int shard, int shards, ShardControl* control, ShardInbox* inboxes,
+                     ShardStats* stats) {
+    Scene scene(0, static_cast<uint32_t>(config.seed));
+    scene.setLidarEnabled(false);
+    scene.setHistoryEnabled(false);
+    scene.setStatsEnabled(false);
+
+    // Ids of the drones in the scene, kept parallel to the scene's drone indices.
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < config.drones; i++) {
+        uint64_t state = config.seed ^ (static_cast<uint64_t>(i) * 0xd1b54a32d192ed03ULL);
+        glm::vec3 position(uniform(state, -19.0f, 19.0f), uniform(state, 1.0f, 9.0f), uniform(state, -19.0f, 19.0f));
+        if (ownerOf(position.x, shards) != shard)
+            continue;
+        Drone drone(position);
+        drone.setRotation(glm::vec3(0.0f, uniform(state, -180.0f, 180.0f), 0.0f));
+        scene.addDrone(drone);
+        ids.push_back(static_cast<uint32_t>(i));
+    }
+
+    ShardStats result = {};
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> visibleIds;
+    std::vector<std::pair<uint32_t, int>> cells;
+    float stripWidth = (ROOM_MAX - ROOM_MIN) / shards;
+    float left = ROOM_MIN + shard * stripWidth;
+    float right = left + stripWidth;
+    long long startCollisions = scene.getCollisionCount();
+
+    for (int t = 0; t < config.ticks; t++) {
+        control->tick.arriveAndWait();
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < scene.getDroneCount(); i++) {
+            Drone* drone = scene.getDrone(i);
+            drone->moveForward();
+            if (t % (TURN_INTERVAL_BASE + ids[i] % TURN_INTERVAL_SPREAD) == 0)
+                drone->turnLeft();
+        }
+        scene.update();
+
+        // Hand over drones that left the strip. They stay visible here as
+        // ghosts for this tick's near-miss count.
+        positions.clear();
+        visibleIds.clear();
+        std::vector<glm::vec3> departed;
+        std::vector<uint32_t> departedIds;
+        for (int i = 0; i < scene.getDroneCount();) {
+            Drone* drone = scene.getDrone(i);
+            int owner = ownerOf(drone->getPosition().x, shards);
+            if (owner != shard) {
+                int side = owner < shard ? 0 : 1;
+                int neighbour = owner < shard ? shard - 1 : shard + 1;
+                // The neighbour's inbound ring from this side.
+                if (inboxes[neighbour].migrations[1 - side].push({ids[i], *drone})) {
+                    result.migrations++;
+                    departed.push_back(drone->getPosition());
+                    departedIds.push_back(ids[i]);
+                    scene.removeDrone(i);
+                    ids[i] = ids.back();
+                    ids.pop_back();
+                    continue;
+                }
+                result.migrationsDeferred++;
+            }
+            i++;
+        }
+
+        // Send ghosts of the drones near either border, including any that
+        // could not be handed over this tick.
+        for (int i = 0; i < scene.getDroneCount(); i++) {
+            glm::vec3 position = scene.getDrone(i)->getPosition();
+            for (int side = 0; side < 2; side++) {
+                int neighbour = side == 0 ? shard - 1 : shard + 1;
+                bool near = side == 0 ? position.x < left + GHOST_MARGIN : position.x > right - GHOST_MARGIN;
+                if (neighbour < 0 || neighbour >= shards || !near)
+                    continue;
+                if (inboxes[neighbour].ghosts[1 - side].push({ids[i], position}))
+                    result.ghostsSent++;
+                else
+                    result.ghostsDropped++;
+            }
+        }
+
+        auto exchangeStart = std::chrono::steady_clock::now();
+        control->exchange.arriveAndWait();
+        auto exchangeEnd = std::chrono::steady_clock::now();
+
+        ShardInbox &inbox = inboxes[shard];
+        Migrant migrant;
+        for (int side = 0; side < 2; side++) {
+            while (inbox.migrations[side].pop(migrant)) {
+                scene.addDrone(migrant.drone);
+                ids.push_back(migrant.id);
+            }
+        }
+
+        // Owned drones first, then everything only seen.
+        for (int i = 0; i < scene.getDroneCount(); i++) {
+            positions.push_back(scene.getDrone(i)->getPosition());
+            visibleIds.push_back(ids[i]);
+        }
+        int owned = static_cast<int>(positions.size());
+        positions.insert(positions.end(), departed.begin(), departed.end());
+        visibleIds.insert(visibleIds.end(), departedIds.begin(), departedIds.end());
+        Ghost ghost;
+        for (int side = 0; side < 2; side++) {
+            while (inbox.ghosts[side].pop(ghost)) {
+                positions.push_back(ghost.position);
+                visibleIds.push_back(ghost.id);
+            }
+        }
+        result.nearMisses += countNearMisses(positions, visibleIds, owned, cells);
+
+        auto end = std::chrono::steady_clock::now();
+        result.busySeconds += std::chrono::duration<double>(exchangeStart - start).count() +
+                              std::chrono::duration<double>(end - exchangeEnd).count();
+    }
+    // Tell the coordinator the last tick is done.
+    control->tick.arriveAndWait();
+
+    result.ownedAtEnd = scene.getDroneCount();
+    result.collisions = scene.getCollisionCount() - startCollisions;
+    stats[shard] = result;
+}
+
+// Run the swarm on the given number of shards. Returns false if a worker could not be started.
+static bool runSharded(const ShardConfig &config, int shards) {
+    ShardControl* control = mapShared<ShardControl>(1);
+    ShardInbox* inboxes = mapShared<ShardInbox>(shards);
+    ShardStats* stats = mapShared<ShardStats>(shards);
+    if (!control || !inboxes || !stats) {
+        std::cerr << "Failed to map shared memory for " << shards << " shards" << std::endl;
+        return false;
+    }
+    new (control) ShardControl(shards);
+    for (int i = 0; i < shards; i++) {
+        new (&inboxes[i]) ShardInbox();
+        stats[i] = ShardStats();
+    }
+
+    // Buffered output would otherwise be written again by every child.
+    std::cout << std::flush;
+    std::vector<pid_t> workers;
+    for (int shard = 0; shard < shards; shard++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            runShard(config, shard, shards, control, inboxes, stats);
+            _exit(0);
+        }
+        if (pid < 0) {
+            // The workers already started would wait forever for the first tick.
+            std::cerr << "Failed to start worker " << shard << std::endl;
+            for (pid_t worker : workers)
+                kill(worker, SIGKILL);
+            for (pid_t worker : workers)
+                waitpid(worker, nullptr, 0);
+            unmapShared(stats, shards);
+            unmapShared(inboxes, shards);
+            unmapShared(control, 1);
+            return false;
+        }
+        workers.push_back(pid);
+    }
+
+    // The first round waits for every worker to finish setting up, the
+    // last one for every worker to finish its last tick.
+    control->tick.arriveAndWait();
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < config.ticks; t++)
+        control->tick.arriveAndWait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = true;
+    for (pid_t pid : workers) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    ShardStats total = {};
+    int minOwned = config.drones, maxOwned = 0;
+    double maxBusy = 0.0;
+    for (int i = 0; i < shards; i++) {
+        total.ownedAtEnd += stats[i].ownedAtEnd;
+        total.migrations += stats[i].migrations;
+        total.migrationsDeferred += stats[i].migrationsDeferred;
+        total.ghostsSent += stats[i].ghostsSent;
+        total.ghostsDropped += stats[i].ghostsDropped;
+        total.nearMisses += stats[i].nearMisses;
+        total.collisions += stats[i].collisions;
+        minOwned = std::min(minOwned, stats[i].ownedAtEnd);
+        maxOwned = std::max(maxOwned, stats[i].ownedAtEnd);
+        maxBusy = std::max(maxBusy, stats[i].busySeconds);
+    }
+
+    std::cout << shards << " shard" << (shards == 1 ? ": " : "s: ")
+              << static_cast<long long>(static_cast<double>(config.drones) * config.ticks / std::max(seconds, 1e-9))
+              << " drone-ticks/s, " << seconds * 1000.0 / config.ticks << " ms/tick, busiest shard "
+              << static_cast<int>(maxBusy / std::max(seconds, 1e-9) * 100.0 + 0.5) << "% busy" << std::endl
+              << "  drones " << total.ownedAtEnd << " (" << minOwned << ".." << maxOwned << " per shard), migrations "
+              << total.migrations << " (" << total.migrationsDeferred << " deferred), ghosts " << total.ghostsSent
+              << " (" << total.ghostsDropped << " dropped), near misses " << total.nearMisses << ", collisions "
+              << total.collisions << std::endl;
+    if (!ok)
+        std::cerr << "  a worker did not exit cleanly" << std::endl;
+
+    unmapShared(stats, shards);
+    unmapShared(inboxes, shards);
+    unmapShared(control, 1);
+    return ok;
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--drones N] [--ticks N] [--max-shards N] [--seed N]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    ShardConfig config;
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (option == "--drones")
+            config.drones = std::max(1, std::atoi(argv[i + 1]));
+        else if (option == "--ticks")
+            config.ticks = std::max(1, std::atoi(argv[i + 1]));
+        else if (option == "--max-shards")
+            config.maxShards = std::max(1, std::atoi(argv[i + 1]));
+        else if (option == "--seed")
+            config.seed = std::strtoull(argv[i + 1], nullptr, 10);
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::cout << "Sharded swarm: " << config.drones << " drones, " << config.ticks << " ticks, "
+              << sysconf(_SC_NPROCESSORS_ONLN) << " cores" << std::endl;
+    // Without ghost drops, the near-miss and collision totals match for every shard count.
+    bool ok = true;
+    for (int shards = 1; shards <= config.maxShards; shards *= 2)
+        ok = runSharded(config, shards) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "TelemetryStore.h"
+
+// Command-line queries over a telemetry store recorded with `drone --record <file>`.
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage:" << std::endl
+              << "  " << program << " <file> info" << std::endl
+              << "  " << program << " <file> near <x> <y> <z> <radius> [<t1> <t2>]" << std::endl
+              << "  " << program << " <file> maxpitch [<t1> <t2>]" << std::endl
+              << "Times are simulation seconds; without them 'near' covers the whole recording"
+              << " and 'maxpitch' its last hour." << std::endl;
+}
+
+static void printStats(const TelemetryQueryStats &stats) {
+    std::cout << "Blocks scanned: " << stats.blocksScanned << " of " << stats.blocksTotal << std::endl
+              << "Rows scanned: " << stats.rowsScanned << ", rows returned: " << stats.rowsReturned << std::endl
+              << "Column bytes read: " << stats.bytesRead << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    TelemetryReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << "Failed to open telemetry file " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::string command = argv[2];
+    if (command == "info") {
+        std::cout << reader.getRowCount() << " rows in " << reader.getBlockCount() << " blocks, t = "
+                  << reader.getMinTime() << " .. " << reader.getMaxTime() << " s" << std::endl;
+        return 0;
+    }
+
+    if (command == "near" && (argc == 7 || argc == 9)) {
+        glm::vec3 point(std::atof(argv[3]), std::atof(argv[4]), std::atof(argv[5]));
+        float radius = static_cast<float>(std::atof(argv[6]));
+        double t1 = argc == 9 ? std::atof(argv[7]) : reader.getMinTime();
+        double t2 = argc == 9 ? std::atof(argv[8]) : reader.getMaxTime();
+
+        TelemetryQueryStats stats;
+        std::vector<ProximityResult> results = reader.findNear(point, radius, t1, t2, stats);
+        for (auto &result : results) {
+            std::cout << "Drone " << result.drone << ": t = " << result.firstTime << " .. " << result.lastTime
+                      << " s, closest " << result.closestDistance << ", " << result.rows << " samples" << std::endl;
+        }
+        if (results.empty())
+            std::cout << "No drone came within " << radius << " of the point." << std::endl;
+        printStats(stats);
+        return 0;
+    }
+
+    if (command == "maxpitch" && (argc == 3 || argc == 5)) {
+        double t2 = argc == 5 ? std::atof(argv[4]) : reader.getMaxTime();
+        double t1 = argc == 5 ? std::atof(argv[3]) : t2 - 3600.0;
+
+        TelemetryQueryStats stats;
+        std::vector<PitchResult> results = reader.findMaxPitch(t1, t2, stats);
+        for (auto &result : results)
+            std::cout << "Drone " << result.drone << ": max pitch " << result.maxPitch << " at t = " << result.time << " s" << std::endl;
+        printStats(stats);
+        return 0;
+    }
+
+    printUsage(argv[0]);
+    return 1;
+}